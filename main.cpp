@@ -16,8 +16,33 @@
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#endif
+
+// x86 batch kernels (SSE2 baseline, AVX2 selected at runtime)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_KERNELS_X86
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -53,6 +78,24 @@ const int BOSS_AOE_RANGE = 5;
 const int BOSS_DAMAGE = 3;
 const int BOSS_MAX_HP = 5;
 
+// Timer wheel - level 0 has one slot per tick, level 1 one slot per level-0 turn
+const int TIMER_WHEEL_SLOTS = 256;
+const int TIMER_WHEEL_OUTER_SLOTS = 64; // Waits up to 16384 ticks, longer ones re-cascade
+const int TIMER_FLIER_DESCENT = 0;
+const int TIMER_BOSS_WINDUP = 1;  // Walking -> winding up
+const int TIMER_BOSS_TRIGGER = 2; // Winding up -> attack frame
+const int TIMER_BOSS_BLAST = 3;   // Attack frame: fire the blast
+const int TIMER_BOSS_RECOVER = 4; // Back to walking
+const int TIMER_FLIER_SHOT = 5;
+
+// Projectiles - fixed pool, new shots are dropped while it is full
+const int PROJECTILE_CAPACITY = 4096;
+const int PROJECTILE_DAMAGE = 1;
+const int PLAYER_SHOT_SPEED = 2;     // Cells per tick
+const int PLAYER_SHOT_COOLDOWN = 6;  // Ticks between player shots
+const int FLIER_SHOT_INTERVAL = 40;  // Ticks between Flier shots
+const int FLIER_SHOT_RANGE = 4;      // Fliers drop shots when the player is this close horizontally
+
 // Wave constants
 const int MAX_WAVES = 5;
 const int WAVE_DELAY_MS = 2000;
@@ -62,6 +105,77 @@ const int WAVE_ENEMY_INCREMENT_MAX = 4;
 // Frame timing
 const int FRAME_DELAY_MS = 16;
 
+// Jump arcs - a jump that hasn't landed after this many ticks is left out of the table
+const int JUMP_ARC_MAX_TICKS = 60;
+const int JUMPER_MEMORY_TICKS = 100; // Jumpers keep climbing after the player this long after losing sight
+
+// Line of sight - solidity and visibility rows packed 64 cells per word
+const int SOLID_WORDS = (ARENA_WIDTH + 63) / 64;
+
+// Update level of detail - Chebyshev distance tiers around the player
+const int LOD_NEAR_RANGE = JUMP_RANGE;       // Exact update every tick (covers every AI trigger range)
+const int LOD_MID_RANGE = 2 * JUMP_RANGE;    // Update every LOD_MID_INTERVAL ticks
+const int LOD_SLEEP_RANGE = 4 * JUMP_RANGE;  // Beyond this enemies sleep until the player comes near
+const int LOD_MID_INTERVAL = 2;
+const int LOD_FAR_INTERVAL = 4;
+
+// Minimap - each terminal cell shows a block of arena cells
+const int MINIMAP_BLOCK_WIDTH = 4;  // Block size for --minimap when the arena would fit the terminal
+const int MINIMAP_BLOCK_HEIGHT = 2;
+const char MINIMAP_TERRAIN_SHADES[] = " .:%#"; // Solid share of a block: none, up to 1/4, 1/2, 3/4, all
+
+// Event journal
+const unsigned int JOURNAL_MAGIC = 0x4C4E524A; // "JRNL"
+const unsigned int JOURNAL_VERSION = 1;
+const unsigned int JOURNAL_CAPACITY = 1 << 18; // Records in the ring
+
+// Journal event types
+const unsigned char EVENT_SPAWN = 1;
+const unsigned char EVENT_HIT = 2;
+const unsigned char EVENT_KILL = 3;
+const unsigned char EVENT_PLAYER_DAMAGE = 4;
+const unsigned char EVENT_WAVE_START = 5;
+const unsigned char EVENT_WAVE_END = 6;
+
+// World hash (64-bit FNV-1a over whole words)
+const unsigned long long WORLD_HASH_OFFSET = 1469598103934665603ULL;
+const unsigned long long WORLD_HASH_PRIME = 1099511628211ULL;
+const int DIFF_MAX_REPORTED_FIELDS = 40; // Differences listed before the rest are only counted
+
+// Bot players
+const int BOT_KITE_DISTANCE = 6;          // The kiting bot backs off from enemies closer than this
+const int HEADLESS_DEFAULT_TICKS = 36000; // Headless runs stop here if the game hasn't ended
+
+// Scenario files (text, one directive per line)
+const int SCENARIO_VERSION = 1;
+const int SCENARIO_LINE_LENGTH = 256;
+
+// Spectator feed (POSIX shared memory ring of finished frames)
+const unsigned int SPECTATOR_MAGIC = 0x43455053; // "SPEC"
+const int SPECTATOR_RING_FRAMES = 8;
+
+// Session recording (keyframes + RLE-compressed deltas)
+const unsigned int RECORDING_MAGIC = 0x4B435241; // "ARCK"
+const unsigned int RECORDING_VERSION = 1;
+const int RECORDING_KEYFRAME_INTERVAL = 60;     // Seeking decodes at most this many frames
+const int RECORDING_PLANE_SIZE = 2 * ARENA_HEIGHT * ARENA_WIDTH; // Glyph plane then color plane
+const int REPLAY_SEEK_STEP = 300;               // Frames skipped by the seek keys
+
+// Input latency histogram - bucket b counts latencies below 2^(b+6) microseconds
+const int LATENCY_BUCKETS = 16;
+
+// Layers are blended 8 cells per 64-bit word
+static_assert(ARENA_WIDTH % 8 == 0, "Arena rows must be a whole number of words");
+
+// Frame buffer - worst case is a color escape before every cell
+const int FRAME_BUFFER_SIZE = ARENA_HEIGHT * (ARENA_WIDTH * 6 + 8) + 256;
+
+// Batch kernel levels
+const int KERNEL_SCALAR = 0;
+const int KERNEL_SSE2 = 1;
+const int KERNEL_AVX2 = 2;
+const char* const KERNEL_NAMES[] = {"scalar", "sse2", "avx2"};
+
 // ========================================
 // STRUCTURES
 // ========================================
@@ -74,6 +188,7 @@ struct Player {
     int velocityY;
     bool isOnGround;
     bool canDoubleJump;
+    int facing; // -1 = left, 1 = right (direction of shots)
 };
 
 // Attack structure
@@ -95,11 +210,226 @@ struct Enemy {
     int hp;
     bool isActive;
     bool isOnGround;
-    int aiTimer; // For Flier descent timing, Boss attack timing
+    int id; // Stable across removals, timers refer to enemies by id
     char surface; // For Crawler: 'f'=floor, 'r'=right wall, 'l'=left wall, 'c'=ceiling
     int edgeWrapStep; // For Crawler edge wrapping: 0=normal, 1-4=wrapping steps
     int attackState; // For Boss: 0=walking, 1=winding up, 2=attacking
-    int windupTimer; // For Boss windup countdown
+    bool descentDue; // For Flier: descent timer fired, descend on the next update
+    int sweepX;      // Cells passed by this tick's vertical movement (center column)
+    int sweepTop;    // Center rows sweepTop..sweepBottom, empty when sweepTop > sweepBottom
+    int sweepBottom;
+    bool isOnArc;     // For Jumper: airborne on a jump picked from the arc table
+    int arcDirection; // For Jumper: horizontal step per tick while on the arc (-1, 0, 1)
+    int alertTimer;   // For Jumper: updates left before it forgets the player
+    int parkedTimers; // Timer nodes that came due while LOD skipped the enemy, -1 if none
+};
+
+// Enemy type traits - everything that differs between enemy kinds
+struct EnemyTraits {
+    char type;
+    int halfWidth;          // Footprint spans x - halfWidth .. x + halfWidth
+    int halfHeight;         // Footprint spans y - halfHeight .. y + halfHeight
+    bool hasGravity;
+    int startHp;
+    bool diesOnContact;     // Removed after touching the player
+    char glyph;
+    int consoleColor;       // Win32 console attribute
+    const char* ansiColor;  // Same color as an ANSI escape
+};
+
+const int ENEMY_KIND_COUNT = 5;
+
+constexpr EnemyTraits ENEMY_TRAITS[ENEMY_KIND_COUNT] = {
+    // type  footprint  gravity  hp           contact  glyph  color
+    {'E',    0, 0,      true,    1,           true,    'E',   10, "\x1b[92m"}, // Walker - light green
+    {'J',    0, 0,      true,    1,           true,    'J',   14, "\x1b[93m"}, // Jumper - yellow
+    {'F',    0, 0,      false,   1,           true,    'F',   11, "\x1b[96m"}, // Flier - cyan
+    {'C',    0, 0,      false,   1,           true,    'C',   13, "\x1b[95m"}, // Crawler - magenta
+    {'B',    1, 1,      true,    BOSS_MAX_HP, false,   'B',   12, "\x1b[91m"}, // Boss - light red, 3x3
+};
+
+// Fallback for anything that is not an enemy (default white)
+constexpr EnemyTraits DEFAULT_TRAITS = {' ', 0, 0, false, 1, true, ' ', 7, "\x1b[0m"};
+
+constexpr const EnemyTraits& traitsOf(char type) {
+    for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+        if (ENEMY_TRAITS[k].type == type) return ENEMY_TRAITS[k];
+    }
+    return DEFAULT_TRAITS;
+}
+
+// Where a jump from a standing cell lands - landX < 0 if it never does
+struct JumpArc {
+    short landX;
+    short landY;
+    short ticks;
+    short minX, maxX; // Cells the jump passes through (minX > maxX if none)
+    short minY, maxY;
+};
+
+// Queued spawn - type '?' rolls a random type, x < 0 picks a random spot
+struct SpawnOrder {
+    char type;
+    int x;
+    int y;
+};
+
+// How a wave's spawn queue is released over time
+struct SpawnCurve {
+    int burst;          // Released together with the wave start
+    int perTick;        // Released on every following tick
+    int budgetMicros;   // Time budget per tick for placement and allocation
+};
+
+// Per-wave spawn curves (index 0 unused) - the normal waves fit in the burst,
+// so only scaled-up waves are actually streamed
+const SpawnCurve WAVE_SPAWN_CURVES[MAX_WAVES + 1] = {
+    {0, 0, 0},
+    {64, 16, 1000},   // Wave 1
+    {64, 32, 1000},   // Wave 2
+    {64, 48, 1000},   // Wave 3
+    {64, 64, 1000},   // Wave 4
+    {64, 16, 1000},   // Wave 5 (Boss)
+};
+
+// Everything but the enemy and projectile arrays that the differential runner compares
+struct WorldSnapshot {
+    unsigned int tick;
+    int wave;
+    Player player;
+    Attack attack;
+    int attackCooldown;
+    int playerShotCooldown;
+    int enemyCount;
+    int enemyCountToSpawn;
+    int projectileCount;
+    unsigned long long terrainHash;
+    unsigned long long timerHash;
+};
+
+// Bot player - decide() looks at the world and returns the key to press this tick (0 = none)
+struct BotPolicy {
+    const char* name;
+    char (*decide)();
+};
+
+// Named scenario written by --generate-scenario
+struct ScenarioGenerator {
+    const char* name;
+    void (*write)(FILE* file);
+};
+
+// Collision stage output - applied by resolveHitEvents()
+const int HIT_ATTACK_ENEMY = 0; // Player attack hits an enemy
+const int HIT_ENEMY_PLAYER = 1; // Enemy touches the player
+const int HIT_AOE_PLAYER = 2;   // Boss blast catches the player
+const int HIT_SHOT_ENEMY = 3;   // Player projectile hits an enemy
+const int HIT_SHOT_PLAYER = 4;  // Enemy projectile hits the player (enemyIndex is -1)
+
+struct HitEvent {
+    int kind;
+    int enemyIndex;
+    int damage;
+    char source; // Type of whatever dealt the damage (for the journal)
+};
+
+// Pending wake-up for one enemy - nodes live in a pool and are chained per slot
+struct TimerNode {
+    int enemyId;
+    int kind;
+    unsigned int due; // Tick on which it fires
+    int next;         // Next node in the same slot or free list, -1 ends
+};
+
+// Boss blast fired by the AI this tick, tested against the player by detectCollisions()
+struct AoeBlast {
+    int enemyIndex;
+    int x;
+    int y;
+    int range;
+    int damage;
+};
+
+// Journal file header, followed by JOURNAL_CAPACITY records
+struct JournalHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int capacity;
+    unsigned int recordSize;
+    unsigned long long writeCount; // Total records ever written (ring wraps)
+};
+
+// One journal record - fixed 16-byte binary layout
+struct JournalRecord {
+    unsigned int tick;
+    unsigned char type;   // EVENT_*
+    char enemyType;       // Enemy involved, 0 if none
+    short x;
+    short y;
+    short value;          // Damage dealt or hp left
+    unsigned short wave;
+    unsigned short reserved;
+};
+
+// Recording file header
+struct RecordingHeader {
+    unsigned int magic;
+    unsigned int version;
+    int width;
+    int height;
+    int keyframeInterval;
+};
+
+// Header before each recorded frame's RLE payload
+struct RecordedFrameHeader {
+    unsigned int frameNumber;
+    unsigned int payloadSize;
+    int hp;
+    short wave;
+    unsigned char isKeyframe; // Payload is the frame itself, otherwise XOR with the previous frame
+    unsigned char reserved;
+};
+
+// Replay index entry - built from the frame headers without decoding
+struct ReplayIndexEntry {
+    long offset;
+    RecordedFrameHeader header;
+};
+
+// One published frame - sequence is odd while the game is writing the slot
+struct SpectatorFrame {
+    std::atomic<unsigned int> sequence;
+    unsigned int frameNumber;
+    int hp;
+    int wave;
+    int maxWaves;
+    unsigned char glyph[ARENA_HEIGHT * ARENA_WIDTH];
+    unsigned char color[ARENA_HEIGHT * ARENA_WIDTH];
+};
+
+// Shared memory layout - readers map it and read the slots in place
+struct SpectatorFeed {
+    unsigned int magic;
+    int width;
+    int height;
+    int ringFrames;
+    std::atomic<int> isLive;                     // Cleared when the game exits
+    std::atomic<unsigned long long> framesPublished;
+    SpectatorFrame frames[SPECTATOR_RING_FRAMES];
+};
+
+// isLive is also cleared from the interrupt handler
+static_assert(std::atomic<int>::is_always_lock_free, "Spectator live flag must be lock-free");
+
+// Frame layer - one glyph and color byte per cell
+// mask is 0xFF where the layer covers the cell, 0 where it is transparent
+struct FrameLayer {
+    unsigned char glyph[ARENA_HEIGHT * ARENA_WIDTH];
+    unsigned char color[ARENA_HEIGHT * ARENA_WIDTH]; // Enemy type for colored cells, 0 otherwise
+    unsigned char mask[ARENA_HEIGHT * ARENA_WIDTH];
+    int touched[ARENA_HEIGHT * ARENA_WIDTH];         // Cells written this frame
+    int touchedCount;
+    bool rowTouched[ARENA_HEIGHT];
 };
 
 // Global variables
@@ -116,21 +446,250 @@ int combatStyle = 1; // 1 = cooldown-based, 2 = duration-based spam
 // Enemy management
 Enemy* enemies = nullptr;
 int enemyCount = 0;
-int enemyCountToSpawn = 0;
+int enemyCountToSpawn = 0; // Orders still waiting in the spawn queue
 int enemyCapacity = 10;
 
+// Terminal output - whole frame is built here and written at once (POSIX)
+char frameBuffer[FRAME_BUFFER_SIZE];
+int frameLength = 0;
+
+// Output backpressure - bytes outputOffset..outputPendingLength of frameBuffer
+// are still waiting for the terminal, new frames are skipped until they're out
+int outputPendingLength = 0;
+int outputOffset = 0;
+bool lastFrameComplete = true; // The frame rendered this tick reached the terminal
+
+// Output metrics - totals, plus the rates of the last full second for the HUD
+long long outputBytes = 0;
+long long outputWrites = 0;       // write() calls
+long long outputStalls = 0;       // Writes the sink refused (would block)
+long long outputFramesSent = 0;
+long long outputFramesSkipped = 0;
+long long outputWindowStart = -1;
+long long outputWindowBytes = 0;
+long long outputWindowFrames = 0;
+long long outputWindowSkipped = 0;
+long long outputWindowWrites = 0;
+int outputBytesPerSecond = 0;
+int outputFramesPerSecond = 0;
+int outputSkippedPerSecond = 0;
+double outputWritesPerFrame = 0;
+
+#ifndef _WIN32
+struct termios originalTermios;
+bool termiosSaved = false;
+int stdoutFlags = -1; // File status flags of stdout (without O_NONBLOCK), read once
+#endif
+
+// Frame compositor - layers from bottom to top, combined into composedGlyph/Color
+FrameLayer terrainLayer;
+FrameLayer overlayLayer; // Telegraphs (Boss AOE warning)
+FrameLayer entityLayer;  // Enemies and player
+FrameLayer attackLayer;
+bool terrainLayerDirty = true;
+bool rowNeedsCompose[ARENA_HEIGHT];
+unsigned char composedGlyph[ARENA_HEIGHT * ARENA_WIDTH];
+unsigned char composedColor[ARENA_HEIGHT * ARENA_WIDTH];
+
+// Minimap - enemy positions as one bit plane per type (same layout as solidBits),
+// reduced block by block into minimapGlyph/Color
+unsigned long long enemyTypeBits[ENEMY_KIND_COUNT][ARENA_HEIGHT][SOLID_WORDS];
+unsigned char minimapGlyph[ARENA_HEIGHT * ARENA_WIDTH];
+unsigned char minimapColor[ARENA_HEIGHT * ARENA_WIDTH];
+int minimapBlockWidth = 0; // 0 = the arena is drawn cell for cell
+int minimapBlockHeight = 0;
+int minimapWidth = 0;
+int minimapHeight = 0;
+bool minimapLayoutReady = false;
+#ifndef _WIN32
+volatile sig_atomic_t terminalResized = 0; // Set by SIGWINCH
+#endif
+volatile sig_atomic_t quitRequested = 0;   // Set by SIGINT/SIGTERM - loops wind down through the normal shutdown
+
+// Collision map (1 = solid tile), built from arena
+unsigned char solidMap[ARENA_HEIGHT][ARENA_WIDTH];
+
+// Summed-area tables - entry [y][x] counts tiles in rows 0..y-1, columns 0..x-1
+int solidSum[ARENA_HEIGHT + 1][ARENA_WIDTH + 1]; // '#' and '='
+int wallSum[ARENA_HEIGHT + 1][ARENA_WIDTH + 1];  // '#' only (blocks upward movement)
+
+// Line of sight - bit x % 64 of word x / 64 is cell (x, y)
+unsigned long long solidBits[ARENA_HEIGHT][SOLID_WORDS];   // Same tiles as solidMap
+unsigned long long knownBits[ARENA_HEIGHT][SOLID_WORDS];   // Cells traced since the player last moved
+unsigned long long visibleBits[ARENA_HEIGHT][SOLID_WORDS]; // Of those, the ones the player can see
+int visibilitySourceX = -1; // Player cell the cache belongs to
+int visibilitySourceY = -1;
+bool visibilityDirty = true; // Terrain changed since the last trace
+
+// Jump arcs per standing cell, [y][x][direction + 1] - built with the level
+JumpArc jumpArcs[ARENA_HEIGHT][ARENA_WIDTH][3];
+int jumpArcReachX = 0;    // Farthest any stored arc gets from its start cell -
+int jumpArcReachUp = 0;   // bounds the cells updateJumpArcs() has to look at
+int jumpArcReachDown = 0;
+int playerStandY = 0; // Row the player stands on (or will land on), set each AI pass
+
+// Empty cells between (x, y) and the ground below it - [y][x], 0 = standing
+int floorDistance[ARENA_HEIGHT][ARENA_WIDTH];
+
+// Spawn surfaces - x of every '=' tile per row, ascending
+int spawnSurfaceX[ARENA_HEIGHT][ARENA_WIDTH];
+int spawnSurfaceCount[ARENA_HEIGHT];
+
+// Terrain edits since the last flush, and cells the terrain layer still has to pick up
+// (empty when x0 > x1)
+int editX0 = ARENA_WIDTH, editY0 = ARENA_HEIGHT, editX1 = -1, editY1 = -1;
+int renderX0 = ARENA_WIDTH, renderY0 = ARENA_HEIGHT, renderX1 = -1, renderY1 = -1;
+
+// Batch kernels - SoA scratch mirrors of enemy state (16-bit lanes)
+int batchKernelLevel = KERNEL_SCALAR;
+short* batchX = nullptr;
+short* batchY = nullptr;
+short* batchLeft = nullptr;   // Broad-phase box: footprint plus this tick's fall sweep
+short* batchRight = nullptr;
+short* batchTop = nullptr;
+short* batchBottom = nullptr;
+short* batchVelocityX = nullptr;
+short* batchOnGround = nullptr; // 0 or -1 (all bits set)
+short* batchSees = nullptr;     // Player visible from the enemy's cell, 0 or -1
+unsigned char* batchMask = nullptr;
+unsigned char* planJump = nullptr;
+int batchCapacity = 0;
+
+// Collision stage - events for this tick and blasts waiting to be tested
+HitEvent* hitEvents = nullptr;
+int hitEventCount = 0;
+int hitEventCapacity = 0;
+AoeBlast* pendingBlasts = nullptr;
+int pendingBlastCount = 0;
+int pendingBlastCapacity = 0;
+
+// Projectile pool (SoA) - live shots are packed at the front
+short projectileX[PROJECTILE_CAPACITY];
+short projectileY[PROJECTILE_CAPACITY];
+signed char projectileVelocityX[PROJECTILE_CAPACITY];
+signed char projectileVelocityY[PROJECTILE_CAPACITY];
+char projectileSource[PROJECTILE_CAPACITY]; // '@' for the player, otherwise the enemy type
+int projectileCount = 0;
+int playerShotCooldown = 0;
+
+// Enemy index covering each cell (-1 = none), rebuilt when player shots are in flight
+int enemyAtCell[ARENA_HEIGHT][ARENA_WIDTH];
+
+// Command line options
+const char* journalPath = nullptr;
+const char* journalSummaryPath = nullptr;
+bool lowLatencyMode = false;
+bool latencyReport = false;
+bool lodEnabled = false;
+bool destructibleTerrain = false; // Attacks carve '=' platforms
+bool minimapForced = false;       // Draw the minimap even if the arena fits the terminal
+const char* spectatorName = nullptr; // Publish frames under this shared memory name
+const char* watchName = nullptr;     // Spectate another game's feed
+
+const char* recordPath = nullptr;    // Record rendered frames to this file
+const char* playPath = nullptr;      // Replay a recording
+double playSpeed = 1.0;
+int playStartFrame = 0;
+
+const char* scenarioPath = nullptr;      // Start from a scenario file instead of wave 1
+const char* generateName = nullptr;      // Write this named stress scenario and exit
+const char* generatePath = nullptr;
+bool outputStats = false;                // Show output metrics in the HUD and on exit
+const char* botName = nullptr;           // Let a bot play
+bool headlessMode = false;               // No terminal, no frame delay - ticks as fast as possible
+int headlessTickLimit = HEADLESS_DEFAULT_TICKS;
+int startWave = 1;
+int styleOption = 0;                     // Combat style from the command line (0 = ask)
+const BotPolicy* activeBot = nullptr;
+const char* gameOutcome = "";            // How runGameLoop() ended
+bool expectWin = false;                  // Exit status 2 unless the player won (scripted bot checks)
+bool playerWon = false;
+unsigned int gameSeed = 0;
+bool deterministicMode = false;          // Fixed seed - no wall-clock decisions in the simulation
+bool diffMode = false;                   // Run the scalar reference and the optimized path side by side
+
+// World hash - terrainHash is kept up to date by setTile(), the rest is rehashed every tick
+bool worldHashing = false;
+unsigned long long terrainHash = 0;
+unsigned long long worldHash = 0;        // State after the last tick
+unsigned long long runHash = WORLD_HASH_OFFSET; // Chain of every tick's worldHash
+bool scenarioLoaded = false;             // Enemies for the first wave came from the scenario
+
+// Session recording
+FILE* recordingFile = nullptr;
+unsigned int recordedFrames = 0;
+bool recordingFailed = false; // A write failed and recording stopped
+unsigned char recordPlanes[RECORDING_PLANE_SIZE];
+unsigned char recordPrevious[RECORDING_PLANE_SIZE];
+unsigned char recordPayload[2 * RECORDING_PLANE_SIZE]; // RLE worst case doubles the size
+
+// Spectator feed
+SpectatorFeed* spectatorFeed = nullptr;
+char spectatorShmName[64];
+
+// Update level of detail - lodScheduled[i] is 1 if enemy i updates this tick
+unsigned char* lodScheduled = nullptr;
+int lodCapacity = 0;
+int lodTierCounts[4]; // Near, mid, far, asleep
+
+// Input latency measurement (key arrived -> frame showing it flushed)
+long long pendingInputTime = -1;
+long long inputArrivalTime = -1; // When stdin was first seen readable with the key still unread
+long long lastKeyArrival = -1;   // Arrival time of the key readKey() returned last
+long long latencyHistogram[LATENCY_BUCKETS];
+long long latencySamples = 0;
+long long latencyTotal = 0;
+
+// Simulation tick counter (one per updateGame)
+unsigned int currentTick = 0;
+
+// Stable enemy ids - enemyIndexById[id] is the array index, -1 once removed
+int* enemyIndexById = nullptr;
+int enemyIdCapacity = 0;
+int nextEnemyId = 0;
+
+// Timer wheel - slot heads index into timerNodes
+TimerNode* timerNodes = nullptr;
+int timerNodeCapacity = 0;
+int timerFreeList = -1;
+int timerWheel[TIMER_WHEEL_SLOTS];
+int timerWheelOuter[TIMER_WHEEL_OUTER_SLOTS];
+unsigned int timerWheelTick = 0; // Next tick the wheel will process
+bool timerWheelReady = false;
+
+// Event journal (memory-mapped ring file)
+JournalHeader* journal = nullptr;
+JournalRecord* journalRecords = nullptr;
+size_t journalMappedSize = 0;
+
 // Wave management
 int currentWave = 1;
 int totalEnemiesFromPreviousWaves = 0;
 bool waveInProgress = false;
+int waveScale = 1; // Multiplier for the random waves (load testing)
+
+// Spawn director - FIFO ring of pending spawns for the current wave
+SpawnOrder* spawnQueue = nullptr;
+int spawnQueueCapacity = 0;
+int spawnQueueHead = 0;
+SpawnCurve activeSpawnCurve = {0, 0, 0};
 
 // ========================================
 // FUNCTION DECLARATIONS
 // ========================================
 
+// Command line
+bool parseCommandLine(int argc, char* argv[]);
+void printUsage();
+
 // Core game functions
+bool setupWorld();
 void runGameLoop();
+void beginFirstWave();
+void advanceWaves();
+bool checkGameOver();
 void processInput();
+void applyInputKey(char ch);
 void updateGame();
 
 // Menu and initialization
@@ -143,24 +702,124 @@ void initializeEnemies();
 void spawnWave(int waveNumber);
 bool isWaveComplete();
 
+// World hash and differential runner
+unsigned long long mixHash(unsigned long long hash, long long value);
+unsigned long long splitMix64(unsigned long long value);
+unsigned long long hashTile(int cell, char tile);
+unsigned long long hashTerrain();
+unsigned long long hashTimers();
+unsigned long long hashWorldState();
+void fillWorldSnapshot(WorldSnapshot& snapshot);
+bool writeAll(int fd, const void* data, size_t size);
+bool readAll(int fd, void* data, size_t size);
+bool sendWorldState(int fd);
+Enemy* receiveWorldState(int fd, WorldSnapshot& snapshot, short* shots);
+int reportWorldDifferences(const WorldSnapshot& a, const Enemy* enemiesA, const short* shotsA,
+                           const WorldSnapshot& b, const Enemy* enemiesB, const short* shotsB);
+void compareField(const char* group, int index, const char* field, long long a, long long b,
+                  bool isChar, int& differences);
+void runDifferentialChild(int kernelLevel, int commandFd, int resultFd);
+int runDifferential();
+
+// Bot players
+const BotPolicy* findBotPolicy(const char* name);
+int findNearestEnemy();
+char meleeKeyFor(const Enemy& enemy);
+bool canAttackNow();
+char approachKey(int targetX, int targetY);
+char retreatKey(int fromX);
+char decideAggressive();
+char decideKiting();
+char decideBossDodging();
+void printHeadlessReport(long long elapsedMicros);
+
+// Scenarios
+bool loadScenario(const char* path);
+int generateScenario(const char* name, const char* path);
+void writeScenarioHeader(FILE* file, int seed, int wave);
+void generateCrawlerSwarm(FILE* file);
+void generateFlierRow(FILE* file);
+
+// Spawn director
+void queueSpawn(char type, int x, int y);
+int releaseSpawns(int maxCount, int budgetMicros);
+void updateSpawnDirector();
+void spawnRandomEnemy();
+void cleanupSpawnQueue();
+
 // Rendering functions
 void render();
 void renderHUD();
 void renderArena();
-char getCharAtPosition(int i, int j, bool& shouldColor, char& colorChar);
-bool tryRenderAttack(int i, int j, char& outChar);
-bool tryRenderEnemy(int i, int j, char& outChar, char& colorChar);
+void composeFrame();
+void clearLayer(FrameLayer& layer);
+void stampLayer(FrameLayer& layer, int x, int y, char glyph, char color, bool overwrite);
+void blendLayerRow(const FrameLayer& layer, int row);
+void rasterizeTerrainLayer();
+void rasterizeOverlayLayer();
+void rasterizeEntityLayer();
+void rasterizeAttackLayer();
+
+// Minimap
+bool queryTerminalSize(int& columns, int& rows);
+bool updateMinimapLayout();
+int countBits(unsigned long long value);
+int countBlockBits(const unsigned long long bits[ARENA_HEIGHT][SOLID_WORDS], int x0, int y0, int x1, int y1);
+void buildEnemyTypeBits();
+void composeMinimap();
+void renderMinimap();
 
 // Console utility
+void initializeConsole();
+void restoreConsole();
+void restoreTerminalState();
+bool keyPressed();
+char readKey();
+void sleepMs(int milliseconds);
+void clearScreen();
 void moveCursorToTopLeft();
 void hideCursor();
 void setColorForEnemy(char type);
 void resetConsoleColor();
+const char* ansiColorForEnemy(char type);
+void appendFrame(const char* text, int length);
+void flushFrame();
+bool pumpOutput();
+void finishOutput();
+void updateOutputStats();
+void printOutputReport();
+
+// Terrain edits
+void setTile(int x, int y, char tile);
+void flushTerrainEdits();
+void updateCollisionRegion(int x0, int y0, int x1, int y1);
+void updateFloorDistances(int x0, int y0, int x1, int y1);
+void updateSpawnSurfaces(int y0, int y1);
+void updateJumpArcs(int x0, int y0, int x1, int y1);
+void carveAttackTiles();
 
 // Physics and collision
+void buildCollisionMap();
 bool isColliding(int x, int y);
+int countTiles(const int table[ARENA_HEIGHT + 1][ARENA_WIDTH + 1], int x0, int y0, int x1, int y1);
+bool isRectFree(int x0, int y0, int x1, int y1);
+bool hasGroundUnder(int x0, int x1, int y);
+bool isWallInSpan(int x0, int x1, int y);
+bool isSolidBit(int x, int y);
+bool traceLineOfSight(int x0, int y0, int x1, int y1);
+void updateVisibility();
+bool hasLineOfSight(int x, int y);
+void simulateJumpArc(int x, int y, int direction, JumpArc& arc);
+void refreshJumpArc(int x, int y, int d, bool standing);
+void buildJumpArcs();
+int findStandingRow(int x, int y);
+bool startJumpArc(Enemy& enemy);
+bool updateJumperMemory(Enemy& enemy, bool seesPlayer);
+void stepAlongArc(Enemy& enemy);
 void applyGravity();
-void applyEnemyGravity(Enemy& enemy);
+template <char Type> void applyEnemyGravity(Enemy& enemy);
+template <char Type> void updateEnemyPhysics(Enemy& enemy);
+void extendSweep(Enemy& enemy);
 
 // Player systems
 void updatePlayer();
@@ -169,7 +828,8 @@ void updateAttack();
 
 // Enemy systems
 void addEnemy(char type, int x, int y);
-void removeEnemy(int index);
+int placeEnemy(char type, int x, int y);
+void scheduleEnemyTimers(const Enemy& enemy, int timer, int shotTimer);
 void updateEnemies();
 void updateEnemyAI();
 void updateWalkerAI(Enemy& enemy);
@@ -182,11 +842,74 @@ void handleCrawlerRightWallMode(Enemy& enemy);
 void handleCrawlerLeftWallMode(Enemy& enemy);
 void handleCrawlerCeilingMode(Enemy& enemy);
 void handleCrawlerEdgeWrap(Enemy& enemy);
+template <char Type> void updateEnemyKindAI(Enemy& enemy, int index, bool useBatch);
+
+// Batch kernels
+void selectBatchKernels();
+void ensureBatchCapacity(int capacity);
+void gatherEnemyBatch();
+void computeOverlapMask(int x0, int y0, int x1, int y1);
+void planGroundWalkers();
+template <char Type> void applyGroundWalkerPlan(Enemy& enemy, int index);
+
+// Update level of detail
+void scheduleEnemyUpdates();
+bool isEnemyScheduled(int index);
+
+// Timer wheel
+void scheduleTimer(int enemyId, int kind, int delay);
+int allocateTimerNode();
+void insertTimerNode(int node);
+void advanceTimerWheel();
+void fireTimer(int enemyId, int kind);
+void rearmParkedTimers(Enemy& enemy);
+void releaseParkedTimers(Enemy& enemy);
+void cleanupTimerWheel();
+
+// Projectiles
+bool spawnProjectile(int x, int y, int velocityX, int velocityY, char source);
+void firePlayerShot();
+void buildEnemyOccupancy();
+void rasterizeProjectiles();
 
 // Combat systems
-bool isEnemyHitByAttack(Enemy& enemy);
-void checkAttackHits();
-void checkPlayerEnemyCollision();
+void getAttackRect(int& x0, int& y0, int& x1, int& y1);
+void getSlashRect(char direction, int x, int y, int& x0, int& y0, int& x1, int& y1);
+void getAttackOrigin(char direction, int playerX, int playerY, int& x, int& y);
+bool rectsOverlap(int ax0, int ay0, int ax1, int ay1, int bx0, int by0, int bx1, int by1);
+void queueBlast(int enemyIndex, int range, int damage);
+void emitHitEvent(int kind, int enemyIndex, int damage, char source);
+void detectCollisions();
+void sweepProjectiles();
+void resolveHitEvents();
+void cleanupCollisionStage();
+
+// Spectator feed
+bool openSpectatorFeed(const char* name);
+void closeSpectatorFeed();
+void publishSpectatorFrame();
+int watchSpectatorFeed(const char* name);
+void appendArenaCells(const unsigned char* glyphs, const unsigned char* colors);
+
+// Session recording
+int encodeRle(const unsigned char* source, int length, unsigned char* output);
+bool decodeRle(const unsigned char* source, int length, unsigned char* output, int outputLength);
+bool openRecording(const char* path);
+void closeRecording();
+void recordFrame();
+bool seekReplay(FILE* file, const ReplayIndexEntry* index, int target, int& current, unsigned char* planes);
+int playRecording(const char* path);
+
+// Input latency
+long long nowMicroseconds();
+void recordInputLatency();
+void printLatencyReport();
+
+// Event journal
+bool openJournal(const char* path);
+void closeJournal();
+void logEvent(unsigned char type, char enemyType, int x, int y, int value);
+int summarizeJournal(const char* path);
 
 // Cleanup
 void cleanupEnemies();
@@ -195,129 +918,416 @@ void cleanupEnemies();
 // MAIN FUNCTION
 // ========================================
 
-int main() {
+int main(int argc, char* argv[]) {
     srand((unsigned)time(nullptr));
 
-    hideCursor();
-    showCombatMenu();
-    initializeArena();
-    initializePlayer();
-    initializeEnemies();
+    if (!parseCommandLine(argc, argv)) {
+        printUsage();
+        return 1;
+    }
+
+    // Reader mode - summarize a journal and exit
+    if (journalSummaryPath != nullptr) {
+        return summarizeJournal(journalSummaryPath);
+    }
+
+    // Spectator mode - show another game's frames and exit
+    if (watchName != nullptr) {
+        return watchSpectatorFeed(watchName);
+    }
+
+    // Replay mode - play a recording and exit
+    if (playPath != nullptr) {
+        return playRecording(playPath);
+    }
+
+    // Generator mode - write a named scenario and exit
+    if (generateName != nullptr) {
+        return generateScenario(generateName, generatePath);
+    }
+
+    if (deterministicMode) {
+        srand(gameSeed);
+    }
+
+    // Differential mode - two headless runs compared tick by tick
+    if (diffMode) {
+        return runDifferential();
+    }
+
+    if (journalPath != nullptr && !openJournal(journalPath)) {
+        cerr << "Could not open event journal " << journalPath << "\n";
+        return 1;
+    }
+
+    if (spectatorName != nullptr && !openSpectatorFeed(spectatorName)) {
+        cerr << "Could not create spectator feed " << spectatorName << "\n";
+        return 1;
+    }
+
+    if (recordPath != nullptr && !openRecording(recordPath)) {
+        cerr << "Could not create recording " << recordPath << "\n";
+        return 1;
+    }
+
+    if (!setupWorld()) {
+        return 1;
+    }
+
+    if (!headlessMode) {
+        initializeConsole();
+        hideCursor();
+    }
+    selectBatchKernels();
+    worldHashing = headlessMode;
+
+    // A scenario, --style or a headless run fixes the combat style
+    if (!scenarioLoaded && styleOption == 0 && !headlessMode) {
+        showCombatMenu();
+    }
 
     currentAttack.isActive = false;
 
+    long long runStart = nowMicroseconds();
     runGameLoop();
+    long long runMicros = nowMicroseconds() - runStart;
 
     cleanupEnemies();
+    cleanupCollisionStage();
+    cleanupTimerWheel();
+    cleanupSpawnQueue();
+    closeJournal();
+    closeSpectatorFeed();
+    closeRecording();
+
+    if (headlessMode) {
+        printHeadlessReport(runMicros);
+    } else {
+        restoreConsole();
+    }
+
+    if (recordingFailed) {
+        cerr << "Recording " << recordPath << " stopped after " << recordedFrames << " frames - write failed\n";
+    }
+
+    if (latencyReport) {
+        printLatencyReport();
+    }
+    if (outputStats) {
+        printOutputReport();
+    }
+    if (quitRequested) {
+        return 1;
+    }
+    if (expectWin && !playerWon) {
+        return 2;
+    }
     return 0;
 }
 
+// Bot, arena, player and the first wave's state - false if an option is unusable
+bool setupWorld() {
+    if (botName != nullptr) {
+        activeBot = findBotPolicy(botName);
+        if (activeBot == nullptr) return false;
+    }
+
+    initializeArena();
+    initializePlayer();
+    initializeEnemies();
+
+    // Skipped waves still grow the random ones as if they had been played
+    if (startWave > 1) {
+        currentWave = startWave;
+        totalEnemiesFromPreviousWaves = 2;
+        for (int wave = 2; wave < startWave; wave++) {
+            totalEnemiesFromPreviousWaves += WAVE_ENEMY_INCREMENT_MIN +
+                                             rand() % (WAVE_ENEMY_INCREMENT_MAX - WAVE_ENEMY_INCREMENT_MIN + 1);
+        }
+    }
+
+    if (scenarioPath != nullptr && !loadScenario(scenarioPath)) {
+        return false;
+    }
+    if (styleOption != 0) {
+        combatStyle = styleOption;
+    }
+    return true;
+}
+
+// Parse options - returns false on unknown or incomplete options
+bool parseCommandLine(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1 < argc);
+
+        if (strcmp(argv[i], "--journal") == 0 && hasValue) {
+            journalPath = argv[++i];
+        } else if (strcmp(argv[i], "--journal-summary") == 0 && hasValue) {
+            journalSummaryPath = argv[++i];
+        } else if (strcmp(argv[i], "--low-latency") == 0) {
+            lowLatencyMode = true;
+        } else if (strcmp(argv[i], "--latency-report") == 0) {
+            latencyReport = true;
+        } else if (strcmp(argv[i], "--output-stats") == 0) {
+            outputStats = true;
+        } else if (strcmp(argv[i], "--lod") == 0) {
+            lodEnabled = true;
+        } else if (strcmp(argv[i], "--destructible") == 0) {
+            destructibleTerrain = true;
+        } else if (strcmp(argv[i], "--minimap") == 0) {
+            minimapForced = true;
+        } else if (strcmp(argv[i], "--spectator-feed") == 0 && hasValue) {
+            spectatorName = argv[++i];
+        } else if (strcmp(argv[i], "--watch") == 0 && hasValue) {
+            watchName = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--play") == 0 && hasValue) {
+            playPath = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && hasValue) {
+            playSpeed = atof(argv[++i]);
+            if (playSpeed <= 0) return false;
+        } else if (strcmp(argv[i], "--seek") == 0 && hasValue) {
+            playStartFrame = atoi(argv[++i]);
+            if (playStartFrame < 0) return false;
+        } else if (strcmp(argv[i], "--scenario") == 0 && hasValue) {
+            scenarioPath = argv[++i];
+        } else if (strcmp(argv[i], "--generate-scenario") == 0 && i + 2 < argc) {
+            generateName = argv[++i];
+            generatePath = argv[++i];
+        } else if (strcmp(argv[i], "--bot") == 0 && hasValue) {
+            botName = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessMode = true;
+        } else if (strcmp(argv[i], "--expect-win") == 0) {
+            expectWin = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            gameSeed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+            deterministicMode = true;
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            diffMode = true;
+        } else if (strcmp(argv[i], "--ticks") == 0 && hasValue) {
+            headlessTickLimit = atoi(argv[++i]);
+            if (headlessTickLimit < 1) return false;
+        } else if (strcmp(argv[i], "--style") == 0 && hasValue) {
+            styleOption = atoi(argv[++i]);
+            if (styleOption != 1 && styleOption != 2) return false;
+        } else if (strcmp(argv[i], "--wave") == 0 && hasValue) {
+            startWave = atoi(argv[++i]);
+            if (startWave < 1 || startWave > MAX_WAVES) return false;
+        } else if (strcmp(argv[i], "--wave-scale") == 0 && hasValue) {
+            waveScale = atoi(argv[++i]);
+            if (waveScale < 1) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void printUsage() {
+    cerr << "Usage: ascii-knight [options]\n";
+    cerr << "  --journal <file>          Record gameplay events to a binary ring file\n";
+    cerr << "  --journal-summary <file>  Print per-wave summaries of a journal and exit\n";
+    cerr << "  --low-latency             Read input right before the tick that displays it\n";
+    cerr << "  --latency-report          Print an input-to-display latency histogram on exit\n";
+    cerr << "  --output-stats            Show output bytes/s and frames/s, print totals on exit\n";
+    cerr << "  --lod                     Update far-away enemies less often\n";
+    cerr << "  --destructible            Let attacks break platforms\n";
+    cerr << "  --minimap                 Draw a downsampled overview (automatic on small terminals)\n";
+    cerr << "  --wave-scale <n>          Multiply the size of the random waves by n\n";
+    cerr << "  --bot <name>              Let a bot play (aggressive, kiting, boss-dodging)\n";
+    cerr << "  --headless                Run without a terminal at an uncapped tick rate\n";
+    cerr << "  --ticks <n>               Stop a headless run after n ticks (default 36000)\n";
+    cerr << "  --expect-win              Exit with status 2 unless the player wins (bot checks)\n";
+    cerr << "  --seed <n>                Fixed random seed, makes headless runs reproducible\n";
+    cerr << "  --diff                    Run the scalar and optimized paths side by side, report the first difference\n";
+    cerr << "  --style <1|2>             Combat style, skips the menu\n";
+    cerr << "  --wave <n>                Start at wave n\n";
+    cerr << "  --scenario <file>         Start from the enemies and state in a scenario file\n";
+    cerr << "  --generate-scenario <name> <file>\n";
+    cerr << "                            Write a stress scenario (crawlers-10k, fliers-2k-row) and exit\n";
+    cerr << "  --spectator-feed <name>   Publish every frame to POSIX shared memory <name>\n";
+    cerr << "  --watch <name>            Spectate a running game's feed (q to quit)\n";
+    cerr << "  --record <file>           Record rendered frames (keyframes + RLE deltas)\n";
+    cerr << "  --play <file>             Replay a recording (space pause, j/l seek, -/+ speed, q quit)\n";
+    cerr << "  --speed <x>               Replay speed multiplier (default 1)\n";
+    cerr << "  --seek <frame>            Start the replay at this frame\n";
+}
+
 // ========================================
 // CORE GAME LOOP
 // ========================================
 
 // Main game loop - handles wave progression and win/loss conditions
 void runGameLoop() {
-    spawnWave(currentWave);
-    waveInProgress = true;
-
-    while (true) {
-        // Check if current wave is complete
-        if (waveInProgress && isWaveComplete()) {
-            waveInProgress = false;
-            currentWave++;
-
-            if (currentWave <= MAX_WAVES) {
-                Sleep(WAVE_DELAY_MS);
-                spawnWave(currentWave);
-                waveInProgress = true;
+    beginFirstWave();
+
+    while (!quitRequested) {
+        advanceWaves();
+
+        // Victory (all waves complete) or defeat (HP depleted)
+        if (checkGameOver()) {
+            if (!headlessMode) {
+                // Plain text - the last frame has to be out first
+                finishOutput();
+                moveCursorToTopLeft();
+                cout << "\n\n";
+                cout << (playerWon ? "        YOU WIN!\n" : "        GAME OVER!\n");
+                cout << "    Press any key to exit...\n";
+                cout.flush();
+                readKey();
             }
-        }
-
-        // Victory condition: all waves complete
-        if (currentWave > MAX_WAVES && enemyCount == 0) {
-            moveCursorToTopLeft();
-            cout << "\n\n";
-            cout << "        YOU WIN!\n";
-            cout << "    Press any key to exit...\n";
-            _getch();
             break;
         }
 
-        // Defeat condition: HP depleted
-        if (player.hp <= 0) {
-            moveCursorToTopLeft();
-            cout << "\n\n";
-            cout << "        GAME OVER!\n";
-            cout << "    Press any key to exit...\n";
-            _getch();
-            break;
+        if (headlessMode) {
+            // Uncapped - as many ticks as the machine can run
+            processInput();
+            updateGame();
+        } else if (lowLatencyMode) {
+            // Sample input at the last moment so this tick's frame shows it
+            sleepMs(FRAME_DELAY_MS);
+            processInput();
+            updateGame();
+        } else {
+            updateGame();
+            processInput();
+            sleepMs(FRAME_DELAY_MS);
         }
+    }
+}
 
-        updateGame();
-        processInput();
+void beginFirstWave() {
+    if (!scenarioLoaded) {
+        spawnWave(currentWave);
+    }
+    waveInProgress = true;
+    logEvent(EVENT_WAVE_START, 0, 0, 0, enemyCount + enemyCountToSpawn);
+}
+
+// Start the next wave once the current one is cleared
+void advanceWaves() {
+    if (waveInProgress && isWaveComplete()) {
+        logEvent(EVENT_WAVE_END, 0, 0, 0, player.hp);
+        waveInProgress = false;
+        currentWave++;
+
+        if (currentWave <= MAX_WAVES) {
+            if (!headlessMode) {
+                sleepMs(WAVE_DELAY_MS);
+            }
+            spawnWave(currentWave);
+            waveInProgress = true;
+            logEvent(EVENT_WAVE_START, 0, 0, 0, enemyCount + enemyCountToSpawn);
+        }
+    }
+}
 
-        Sleep(FRAME_DELAY_MS);
+// True once the game is over - gameOutcome says how
+bool checkGameOver() {
+    if (currentWave > MAX_WAVES && enemyCount == 0) {
+        gameOutcome = "won";
+        playerWon = true;
+        return true;
+    }
+    if (player.hp <= 0) {
+        gameOutcome = "lost";
+        return true;
     }
+    if (headlessMode && (int)currentTick >= headlessTickLimit) {
+        gameOutcome = "stopped at the tick limit";
+        return true;
+    }
+    return false;
 }
 
 // Process all player input
+// One key per tick from the bot (if one is playing) and from the keyboard
 void processInput() {
-    if (_kbhit()) {
-        char ch = _getch();
+    if (activeBot != nullptr) {
+        applyInputKey(activeBot->decide());
+    }
 
-        // ESC to exit
-        if (ch == 27) {
-            player.hp = 0;
-            return;
-        }
+    if (!headlessMode && keyPressed()) {
+        char ch = readKey();
 
-        // Movement controls
-        if ((ch == 'a' || ch == 'A') && player.x > 1) {
-            player.x--;
-        }
-        if ((ch == 'd' || ch == 'D') && player.x < ARENA_WIDTH - 2) {
-            player.x++;
+        if (pendingInputTime < 0) {
+            pendingInputTime = lastKeyArrival;
         }
+        applyInputKey(ch);
+    }
+}
 
-        // Jump controls (single and double jump)
-        if (ch == 'w' || ch == 'W') {
-            if (player.isOnGround) {
-                player.velocityY = PLAYER_JUMP_VELOCITY;
-                player.isOnGround = false;
-                player.canDoubleJump = true;
-            } else if (player.canDoubleJump) {
-                player.velocityY = PLAYER_JUMP_VELOCITY;
-                player.canDoubleJump = false;
-            }
-        }
+// Apply one key press to the player - 0 means no key
+void applyInputKey(char ch) {
+    // ESC to exit
+    if (ch == 27) {
+        player.hp = 0;
+        return;
+    }
 
-        // Attack controls (four directions)
-        if (ch == 'i' || ch == 'I') {
-            performAttack('i');
-        }
-        if (ch == 'j' || ch == 'J') {
-            performAttack('j');
-        }
-        if (ch == 'k' || ch == 'K') {
-            performAttack('k');
-        }
-        if (ch == 'l' || ch == 'L') {
-            performAttack('l');
+    // Movement controls
+    if (ch == 'a' || ch == 'A') {
+        player.facing = -1;
+        if (player.x > 1) player.x--;
+    }
+    if (ch == 'd' || ch == 'D') {
+        player.facing = 1;
+        if (player.x < ARENA_WIDTH - 2) player.x++;
+    }
+
+    // Jump controls (single and double jump)
+    if (ch == 'w' || ch == 'W') {
+        if (player.isOnGround) {
+            player.velocityY = PLAYER_JUMP_VELOCITY;
+            player.isOnGround = false;
+            player.canDoubleJump = true;
+        } else if (player.canDoubleJump) {
+            player.velocityY = PLAYER_JUMP_VELOCITY;
+            player.canDoubleJump = false;
         }
     }
+
+    // Attack controls (four directions)
+    if (ch == 'i' || ch == 'I') {
+        performAttack('i');
+    }
+    if (ch == 'j' || ch == 'J') {
+        performAttack('j');
+    }
+    if (ch == 'k' || ch == 'K') {
+        performAttack('k');
+    }
+    if (ch == 'l' || ch == 'L') {
+        performAttack('l');
+    }
+
+    // Ranged shot in the facing direction
+    if (ch == 'o' || ch == 'O') {
+        firePlayerShot();
+    }
 }
 
 // Update all game state (physics, AI, collisions)
 void updateGame() {
+    updateSpawnDirector();
     updatePlayer();
     updateAttack();
     updateEnemies();
-    checkAttackHits();
-    checkPlayerEnemyCollision();
+    detectCollisions();
+    resolveHitEvents();
+    carveAttackTiles();
+    flushTerrainEdits();
 
-    moveCursorToTopLeft();
     render();
+    recordInputLatency();
+    currentTick++;
+
+    if (worldHashing) {
+        worldHash = hashWorldState();
+        runHash = (runHash ^ worldHash) * WORLD_HASH_PRIME;
+    }
 }
 
 // ========================================
@@ -325,32 +1335,21 @@ void updateGame() {
 // ========================================
 
 void setColorForEnemy(char type) {
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    switch (type) {
-        case 'E': // Walker
-            SetConsoleTextAttribute(hConsole, 10); // Light green
-            break;
-        case 'J': // Jumper
-            SetConsoleTextAttribute(hConsole, 14); // Yellow
-            break;
-        case 'F': // Flier
-            SetConsoleTextAttribute(hConsole, 11); // Cyan
-            break;
-        case 'C': // Crawler
-            SetConsoleTextAttribute(hConsole, 13); // Magenta
-            break;
-        case 'B': // Boss
-            SetConsoleTextAttribute(hConsole, 12); // Light red
-            break;
-        default:
-            SetConsoleTextAttribute(hConsole, 7); // Default white
-    }
+#ifdef _WIN32
+    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), traitsOf(type).consoleColor);
+#else
+    cout << ansiColorForEnemy(type);
+#endif
 }
 
 // Reset color back to normal
 void resetConsoleColor() {
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 7);
+    setColorForEnemy(' ');
+}
+
+// ANSI escape matching the console color of each enemy type
+const char* ansiColorForEnemy(char type) {
+    return traitsOf(type).ansiColor;
 }
 
 // ========================================
@@ -358,7 +1357,7 @@ void resetConsoleColor() {
 // ========================================
 
 void showCombatMenu() {
-    system("cls");
+    clearScreen();
     cout << "\n\n";
     cout << "        =================================\n";
     cout << "              ASCII KNIGHT GAME\n";
@@ -372,15 +1371,17 @@ void showCombatMenu() {
     cout << "           - Can be spammed rapidly\n\n";
     cout << "        Enter your choice (1 or 2): ";
 
+    cout.flush();
+
     char choice;
-    while (true) {
-        choice = _getch();
+    while (!quitRequested) {
+        choice = readKey();
         if (choice == '1' || choice == '2') {
             combatStyle = choice - '0';
             cout << choice << "\n\n";
             cout << "        Combat style selected! Starting game...\n";
-            Sleep(1500);
-            system("cls");
+            sleepMs(1500);
+            clearScreen();
             break;
         }
     }
@@ -413,7 +1414,96 @@ void initializeArena() {
     for (int j = 5; j < 50; j++) arena[ARENA_HEIGHT - 6][j] = '=';
     for (int j = 30; j < 60; j++) arena[ARENA_HEIGHT - 12][j] = '=';
     for (int j = 50; j < 90; j++) arena[ARENA_HEIGHT - 18][j] = '=';
- 
+
+    buildCollisionMap();
+    buildJumpArcs();
+    updateFloorDistances(0, 0, ARENA_WIDTH - 1, ARENA_HEIGHT - 1);
+    updateSpawnSurfaces(0, ARENA_HEIGHT - 1);
+    terrainLayerDirty = true;
+    terrainHash = hashTerrain();
+}
+
+// ========================================
+// TERRAIN EDITS
+// ========================================
+
+// The only way to change a tile after initializeArena(). Structures derived
+// from the arena are brought up to date by flushTerrainEdits().
+void setTile(int x, int y, char tile) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) return;
+    if (arena[y][x] == tile) return;
+
+    int cell = y * ARENA_WIDTH + x;
+    terrainHash ^= hashTile(cell, arena[y][x]) ^ hashTile(cell, tile);
+
+    arena[y][x] = tile;
+    if (x < editX0) editX0 = x;
+    if (x > editX1) editX1 = x;
+    if (y < editY0) editY0 = y;
+    if (y > editY1) editY1 = y;
+}
+
+// Update everything derived from tiles, only around the edited rectangle
+void flushTerrainEdits() {
+    if (editX0 > editX1) return;
+
+    updateCollisionRegion(editX0, editY0, editX1, editY1);
+    updateFloorDistances(editX0, editY0, editX1, editY1);
+    updateSpawnSurfaces(editY0, editY1);
+    updateJumpArcs(editX0, editY0, editX1, editY1);
+
+    if (editX0 < renderX0) renderX0 = editX0;
+    if (editX1 > renderX1) renderX1 = editX1;
+    if (editY0 < renderY0) renderY0 = editY0;
+    if (editY1 > renderY1) renderY1 = editY1;
+
+    editX0 = ARENA_WIDTH;
+    editY0 = ARENA_HEIGHT;
+    editX1 = editY1 = -1;
+}
+
+// A tile only changes distances above it in its own column. Walking up from
+// the edit, the first unchanged cell above the edited rows ends the column.
+void updateFloorDistances(int x0, int y0, int x1, int y1) {
+    for (int j = x0; j <= x1; j++) {
+        for (int i = y1; i >= 0; i--) {
+            int previous = floorDistance[i][j];
+            if (i == ARENA_HEIGHT - 1 || solidMap[i + 1][j]) {
+                floorDistance[i][j] = 0;
+            } else {
+                floorDistance[i][j] = floorDistance[i + 1][j] + 1;
+            }
+            if (i < y0 && floorDistance[i][j] == previous) break;
+        }
+    }
+}
+
+// Platform tiles enemies can spawn on, rebuilt per edited row
+void updateSpawnSurfaces(int y0, int y1) {
+    for (int i = y0; i <= y1; i++) {
+        spawnSurfaceCount[i] = 0;
+        for (int j = 1; j < ARENA_WIDTH - 1; j++) {
+            if (arena[i][j] == '=') {
+                spawnSurfaceX[i][spawnSurfaceCount[i]++] = j;
+            }
+        }
+    }
+}
+
+// With --destructible an active attack breaks the platform tiles it covers
+void carveAttackTiles() {
+    if (!destructibleTerrain || !currentAttack.isActive) return;
+
+    int x0, y0, x1, y1;
+    getAttackRect(x0, y0, x1, y1);
+    for (int i = y0; i <= y1; i++) {
+        for (int j = x0; j <= x1; j++) {
+            if (j <= 0 || j >= ARENA_WIDTH - 1 || i <= 0 || i >= ARENA_HEIGHT - 1) continue;
+            if (arena[i][j] == '=') {
+                setTile(j, i, ' ');
+            }
+        }
+    }
 }
 
 // ========================================
@@ -427,6 +1517,7 @@ void initializePlayer() {
     player.velocityY = 0;
     player.isOnGround = false;
     player.canDoubleJump = false;
+    player.facing = 1;
 }
 
 void updatePlayer() {
@@ -437,94 +1528,407 @@ void updatePlayer() {
 // PHYSICS SYSTEM
 // ========================================
 
-bool isColliding(int x, int y) {
-    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) {
-        return true;
-    }
-    return arena[y][x] == '#' || arena[y][x] == '=';
-}
-bool isEnemyHitByAttack(Enemy& enemy) {
-    if (!currentAttack.isActive) return false;
-
-    // Determine attack hitbox
-    int hitX[3], hitY[3];
-    int hitCount = 0;
-
-    if (currentAttack.direction == 'i') { // Up
-        hitY[0] = hitY[1] = hitY[2] = currentAttack.y;
-        hitX[0] = currentAttack.x;
-        hitX[1] = currentAttack.x + 1;
-        hitX[2] = currentAttack.x + 2;
-        hitCount = 3;
-    } else if (currentAttack.direction == 'j') { // Left
-        hitX[0] = hitX[1] = hitX[2] = currentAttack.x;
-        hitY[0] = currentAttack.y;
-        hitY[1] = currentAttack.y + 1;
-        hitY[2] = currentAttack.y + 2;
-        hitCount = 3;
-    } else if (currentAttack.direction == 'k') { // Down
-        hitY[0] = hitY[1] = hitY[2] = currentAttack.y;
-        hitX[0] = currentAttack.x;
-        hitX[1] = currentAttack.x + 1;
-        hitX[2] = currentAttack.x + 2;
-        hitCount = 3;
-    } else if (currentAttack.direction == 'l') { // Right
-        hitX[0] = hitX[1] = hitX[2] = currentAttack.x;
-        hitY[0] = currentAttack.y;
-        hitY[1] = currentAttack.y + 1;
-        hitY[2] = currentAttack.y + 2;
-        hitCount = 3;
-    }
-
-    // Check collision
-    for (int h = 0; h < hitCount; h++) {
-        if (enemy.type == 'B') {
-            // Boss 3x3 hitbox
-            if (hitX[h] >= enemy.x - 1 && hitX[h] <= enemy.x + 1 &&
-                hitY[h] >= enemy.y - 1 && hitY[h] <= enemy.y + 1) {
-                return true;
-            }
-        } else {
-            // Normal 1x1 enemy
-            if (enemy.x == hitX[h] && enemy.y == hitY[h]) {
-                return true;
+// Rebuild the collision map from arena tiles
+void buildCollisionMap() {
+    updateCollisionRegion(0, 0, ARENA_WIDTH - 1, ARENA_HEIGHT - 1);
+}
+
+// Refresh the collision map, solidity bits and summed-area tables for tiles
+// in [x0..x1] x [y0..y1]. A table entry only depends on tiles above and to
+// the left of it, so entries before the rectangle's corner stay valid.
+// Row 0 and column 0 of the tables are always zero.
+void updateCollisionRegion(int x0, int y0, int x1, int y1) {
+    for (int i = y0; i <= y1; i++) {
+        for (int j = x0; j <= x1; j++) {
+            solidMap[i][j] = (arena[i][j] == '#' || arena[i][j] == '=') ? 1 : 0;
+            if (solidMap[i][j]) {
+                solidBits[i][j / 64] |= 1ULL << (j % 64);
+            } else {
+                solidBits[i][j / 64] &= ~(1ULL << (j % 64));
             }
         }
     }
 
-    return false;
+    for (int i = y0 + 1; i <= ARENA_HEIGHT; i++) {
+        for (int j = x0 + 1; j <= ARENA_WIDTH; j++) {
+            int isWall = (arena[i - 1][j - 1] == '#') ? 1 : 0;
+            solidSum[i][j] = solidMap[i - 1][j - 1] + solidSum[i - 1][j] + solidSum[i][j - 1] - solidSum[i - 1][j - 1];
+            wallSum[i][j] = isWall + wallSum[i - 1][j] + wallSum[i][j - 1] - wallSum[i - 1][j - 1];
+        }
+    }
+    visibilityDirty = true;
 }
 
+// Tiles inside the inclusive rectangle [x0..x1] x [y0..y1] (must be inside the arena)
+int countTiles(const int table[ARENA_HEIGHT + 1][ARENA_WIDTH + 1], int x0, int y0, int x1, int y1) {
+    return table[y1 + 1][x1 + 1] - table[y0][x1 + 1] - table[y1 + 1][x0] + table[y0][x0];
+}
 
-// Apply gravity to player - handles falling, jumping, and platform collision
-void applyGravity() {
-    player.velocityY += GRAVITY;
-
-    if (player.velocityY > PLAYER_MAX_FALL_SPEED) {
-        player.velocityY = PLAYER_MAX_FALL_SPEED;
+// O(1) - true if no solid tile lies in the rectangle (outside the arena counts as solid)
+bool isRectFree(int x0, int y0, int x1, int y1) {
+    if (x0 < 0 || y0 < 0 || x1 >= ARENA_WIDTH || y1 >= ARENA_HEIGHT) {
+        return false;
     }
+    return countTiles(solidSum, x0, y0, x1, y1) == 0;
+}
 
-    // Falling downward
-    if (player.velocityY > 0) {
-        // Move down one pixel at a time to avoid falling through platforms
-        for (int i = 0; i < player.velocityY; i++) {
-            int nextY = player.y + 1;
+// O(1) - true if any tile of row y between x0 and x1 can be stood on
+bool hasGroundUnder(int x0, int x1, int y) {
+    return !isRectFree(x0, y, x1, y);
+}
 
-            if (isColliding(player.x, nextY)) {
-                player.velocityY = 0;
-                player.isOnGround = true;
-                player.canDoubleJump = false;
-                break;
-            } else {
-                player.y = nextY;
-                player.isOnGround = false;
-            }
-        }
+// O(1) - true if a wall blocks upward movement anywhere in the span
+bool isWallInSpan(int x0, int x1, int y) {
+    if (x0 < 0 || y < 0 || x1 >= ARENA_WIDTH || y >= ARENA_HEIGHT) {
+        return true;
     }
-    // Jumping upward
-    else if (player.velocityY < 0) {
-        for (int i = 0; i < -player.velocityY; i++) {
-            int nextY = player.y - 1;
+    return countTiles(wallSum, x0, y, x1, y) > 0;
+}
+
+bool isColliding(int x, int y) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) {
+        return true;
+    }
+    return solidMap[y][x] != 0;
+}
+
+// ========================================
+// LINE OF SIGHT
+// ========================================
+
+// Callers stay inside the arena
+bool isSolidBit(int x, int y) {
+    return (solidBits[y][x / 64] >> (x % 64)) & 1;
+}
+
+// Bresenham ray - blocked by any solid tile strictly between the two ends
+bool traceLineOfSight(int x0, int y0, int x1, int y1) {
+    int dx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+    int dy = (y1 > y0) ? (y0 - y1) : (y1 - y0); // Negative
+    int stepX = (x0 < x1) ? 1 : -1;
+    int stepY = (y0 < y1) ? 1 : -1;
+    int error = dx + dy;
+    int x = x0, y = y0;
+
+    while (true) {
+        int doubled = 2 * error;
+        if (doubled >= dy) {
+            error += dy;
+            x += stepX;
+        }
+        if (doubled <= dx) {
+            error += dx;
+            y += stepY;
+        }
+        if (x == x1 && y == y1) return true;
+        if (isSolidBit(x, y)) return false;
+    }
+}
+
+// Drop the cached cells once the player moves or the terrain changes
+void updateVisibility() {
+    if (!visibilityDirty && player.x == visibilitySourceX && player.y == visibilitySourceY) return;
+
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        for (int w = 0; w < SOLID_WORDS; w++) {
+            knownBits[i][w] = 0;
+            visibleBits[i][w] = 0;
+        }
+    }
+    visibilitySourceX = player.x;
+    visibilitySourceY = player.y;
+    visibilityDirty = false;
+}
+
+// Can the player see cell (x, y)? Each cell is traced at most once per
+// player position, so enemies sharing a cell (or asking again) reuse the
+// ray. Call updateVisibility() first.
+bool hasLineOfSight(int x, int y) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) return false;
+
+    unsigned long long bit = 1ULL << (x % 64);
+    if (!(knownBits[y][x / 64] & bit)) {
+        knownBits[y][x / 64] |= bit;
+
+        bool playerInside = player.x >= 0 && player.x < ARENA_WIDTH && player.y >= 0 && player.y < ARENA_HEIGHT;
+        if (playerInside && !isSolidBit(x, y) &&
+            ((x == player.x && y == player.y) || traceLineOfSight(player.x, player.y, x, y))) {
+            visibleBits[y][x / 64] |= bit;
+        }
+    }
+    return (visibleBits[y][x / 64] & bit) != 0;
+}
+
+// ========================================
+// JUMP ARCS
+// ========================================
+
+// Play a Jumper's jump from standing cell (x, y) through the same rules the
+// game uses: the AI sets the jump velocity and takes the first horizontal
+// step, then every tick applies applyEnemyGravity<'J'> followed by
+// stepAlongArc(). Changing either of those means changing this too.
+void simulateJumpArc(int x, int y, int direction, JumpArc& arc) {
+    arc.landX = -1;
+    arc.landY = -1;
+    arc.ticks = 0;
+    arc.minX = arc.maxX = (short)x;
+    arc.minY = arc.maxY = (short)y;
+
+    int velocityY = PLAYER_JUMP_VELOCITY;
+    int nextX = x + direction;
+    if (direction != 0) {
+        if (nextX < 1 || nextX >= ARENA_WIDTH - 1 || isWallInSpan(nextX, nextX, y)) {
+            direction = 0;
+        } else {
+            x = nextX;
+        }
+    }
+    if (x < arc.minX) arc.minX = (short)x;
+    if (x > arc.maxX) arc.maxX = (short)x;
+
+    for (int tick = 1; tick <= JUMP_ARC_MAX_TICKS; tick++) {
+        velocityY += GRAVITY;
+        if (velocityY > PLAYER_MAX_FALL_SPEED) {
+            velocityY = PLAYER_MAX_FALL_SPEED;
+        }
+
+        if (velocityY > 0) {
+            for (int i = 0; i < velocityY; i++) {
+                if (hasGroundUnder(x, x, y + 1)) {
+                    arc.landX = (short)x;
+                    arc.landY = (short)y;
+                    arc.ticks = (short)tick;
+                    return;
+                }
+                y++;
+                if (y > arc.maxY) arc.maxY = (short)y;
+            }
+        } else if (velocityY < 0) {
+            for (int i = 0; i < -velocityY; i++) {
+                if (isWallInSpan(x, x, y - 1)) {
+                    velocityY = 0;
+                    break;
+                }
+                y--;
+                if (y < arc.minY) arc.minY = (short)y;
+            }
+        }
+
+        nextX = x + direction;
+        if (direction != 0) {
+            if (nextX < 1 || nextX >= ARENA_WIDTH - 1 || isWallInSpan(nextX, nextX, y)) {
+                direction = 0;
+            } else {
+                x = nextX;
+            }
+        }
+        if (x < arc.minX) arc.minX = (short)x;
+        if (x > arc.maxX) arc.maxX = (short)x;
+    }
+}
+
+// Re-simulate jump d from (x, y), or clear it if nobody can stand there
+void refreshJumpArc(int x, int y, int d, bool standing) {
+    JumpArc& arc = jumpArcs[y][x][d];
+    if (!standing) {
+        arc.landX = arc.landY = -1;
+        arc.ticks = 0;
+        arc.minX = 1;
+        arc.maxX = 0;
+        arc.minY = arc.maxY = 0;
+        return;
+    }
+
+    simulateJumpArc(x, y, d - 1, arc);
+    if (x - arc.minX > jumpArcReachX) jumpArcReachX = x - arc.minX;
+    if (arc.maxX - x > jumpArcReachX) jumpArcReachX = arc.maxX - x;
+    if (y - arc.minY > jumpArcReachUp) jumpArcReachUp = y - arc.minY;
+    if (arc.maxY - y > jumpArcReachDown) jumpArcReachDown = arc.maxY - y;
+}
+
+// Landing cell of all three jumps (left, straight up, right) from every
+// standing cell
+void buildJumpArcs() {
+    jumpArcReachX = jumpArcReachUp = jumpArcReachDown = 0;
+
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        for (int j = 0; j < ARENA_WIDTH; j++) {
+            bool standing = isRectFree(j, i, j, i) && hasGroundUnder(j, j, i + 1);
+            for (int d = 0; d < 3; d++) {
+                refreshJumpArc(j, i, d, standing);
+            }
+        }
+    }
+}
+
+// After tiles in [x0..x1] x [y0..y1] changed: re-simulate the jumps whose
+// path (plus the cells they test around it) touches the rectangle, and the
+// cells whose standing status may have changed (the rectangle and the row
+// above). Only start cells within one jump's reach of the rectangle can
+// have an arc crossing it, so the scan stops there.
+void updateJumpArcs(int x0, int y0, int x1, int y1) {
+    int scanX0 = x0 - 1 - jumpArcReachX;
+    int scanX1 = x1 + 1 + jumpArcReachX;
+    int scanY0 = y0 - 1 - jumpArcReachDown;
+    int scanY1 = y1 + 1 + jumpArcReachUp;
+    if (scanX0 < 0) scanX0 = 0;
+    if (scanX1 > ARENA_WIDTH - 1) scanX1 = ARENA_WIDTH - 1;
+    if (scanY0 < 0) scanY0 = 0;
+    if (scanY1 > ARENA_HEIGHT - 1) scanY1 = ARENA_HEIGHT - 1;
+
+    for (int i = scanY0; i <= scanY1; i++) {
+        for (int j = scanX0; j <= scanX1; j++) {
+            bool statusChanged = j >= x0 && j <= x1 && i >= y0 - 1 && i <= y1;
+
+            // Standing status is only re-tested where the edit could change it -
+            // elsewhere only cells with an arc (so standing ones) get here
+            bool standing = !statusChanged || (isRectFree(j, i, j, i) && hasGroundUnder(j, j, i + 1));
+
+            for (int d = 0; d < 3; d++) {
+                const JumpArc& arc = jumpArcs[i][j][d];
+                bool crosses = arc.minX <= arc.maxX &&
+                               arc.minX - 1 <= x1 && arc.maxX + 1 >= x0 &&
+                               arc.minY - 1 <= y1 && arc.maxY + 1 >= y0;
+                if (!statusChanged && !crosses) continue;
+
+                refreshJumpArc(j, i, d, standing);
+            }
+        }
+    }
+}
+
+// First row at or below y with ground under it (the platform something at (x, y) is on or over)
+int findStandingRow(int x, int y) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) return y;
+    return y + floorDistance[y][x];
+}
+
+// Take the jump whose landing is closest to the player's platform (height
+// first, then distance), if any gets closer than standing still
+bool startJumpArc(Enemy& enemy) {
+    if (enemy.x < 0 || enemy.x >= ARENA_WIDTH || enemy.y < 0 || enemy.y >= ARENA_HEIGHT) return false;
+
+    int dx = (player.x > enemy.x) ? (player.x - enemy.x) : (enemy.x - player.x);
+    int dy = (playerStandY > enemy.y) ? (playerStandY - enemy.y) : (enemy.y - playerStandY);
+    int bestScore = dy * ARENA_WIDTH + dx;
+    int bestDirection = 2; // None
+
+    for (int d = 0; d < 3; d++) {
+        const JumpArc& arc = jumpArcs[enemy.y][enemy.x][d];
+        if (arc.landX < 0) continue;
+
+        dx = (player.x > arc.landX) ? (player.x - arc.landX) : (arc.landX - player.x);
+        dy = (playerStandY > arc.landY) ? (playerStandY - arc.landY) : (arc.landY - playerStandY);
+        if (dy * ARENA_WIDTH + dx < bestScore) {
+            bestScore = dy * ARENA_WIDTH + dx;
+            bestDirection = d - 1;
+        }
+    }
+    if (bestDirection == 2) return false;
+
+    enemy.velocityY = PLAYER_JUMP_VELOCITY;
+    enemy.isOnGround = false;
+    enemy.isOnArc = true;
+    enemy.arcDirection = bestDirection;
+    stepAlongArc(enemy);
+    return true;
+}
+
+// Platforms hide the player from below, so a Jumper remembers it for a while
+// after losing sight. Returns true while it still knows where the player is.
+bool updateJumperMemory(Enemy& enemy, bool seesPlayer) {
+    if (seesPlayer) {
+        enemy.alertTimer = JUMPER_MEMORY_TICKS;
+    } else if (enemy.alertTimer > 0) {
+        enemy.alertTimer--;
+    }
+    return enemy.alertTimer > 0;
+}
+
+// Horizontal part of an arc - only walls and the arena edge stop it
+void stepAlongArc(Enemy& enemy) {
+    if (enemy.arcDirection == 0) return;
+
+    int nextX = enemy.x + enemy.arcDirection;
+    if (nextX < 1 || nextX >= ARENA_WIDTH - 1 || isWallInSpan(nextX, nextX, enemy.y)) {
+        enemy.arcDirection = 0;
+    } else {
+        enemy.x = nextX;
+    }
+}
+// Attack hitbox as an inclusive rectangle (3 cells wide or tall)
+void getAttackRect(int& x0, int& y0, int& x1, int& y1) {
+    getSlashRect(currentAttack.direction, currentAttack.x, currentAttack.y, x0, y0, x1, y1);
+}
+
+// Cells a slash starting at (x, y) covers
+void getSlashRect(char direction, int x, int y, int& x0, int& y0, int& x1, int& y1) {
+    x0 = x1 = x;
+    y0 = y1 = y;
+
+    if (direction == 'i' || direction == 'k') {
+        x1 = x + 2; // Horizontal slash
+    } else {
+        y1 = y + 2; // Vertical slash
+    }
+}
+
+// Top-left cell of a slash made from (playerX, playerY)
+void getAttackOrigin(char direction, int playerX, int playerY, int& x, int& y) {
+    switch (direction) {
+        case 'i': // Up
+            x = playerX - 1;
+            y = playerY - 2;
+            break;
+        case 'j': // Left
+            x = playerX - 2;
+            y = playerY - 1;
+            break;
+        case 'k': // Down
+            x = playerX - 1;
+            y = playerY + 1;
+            break;
+        case 'l': // Right
+            x = playerX + 1;
+            y = playerY - 1;
+            break;
+    }
+}
+
+// Inclusive rectangles
+bool rectsOverlap(int ax0, int ay0, int ax1, int ay1, int bx0, int by0, int bx1, int by1) {
+    return ax1 >= bx0 && ax0 <= bx1 && ay1 >= by0 && ay0 <= by1;
+}
+
+// Apply gravity to player - handles falling, jumping, and platform collision
+void applyGravity() {
+    player.velocityY += GRAVITY;
+
+    if (player.velocityY > PLAYER_MAX_FALL_SPEED) {
+        player.velocityY = PLAYER_MAX_FALL_SPEED;
+    }
+
+    // Falling downward
+    if (player.velocityY > 0) {
+        // Move down one pixel at a time to avoid falling through platforms
+        for (int i = 0; i < player.velocityY; i++) {
+            int nextY = player.y + 1;
+
+            if (isColliding(player.x, nextY)) {
+                player.velocityY = 0;
+                player.isOnGround = true;
+                player.canDoubleJump = false;
+                break;
+            } else {
+                player.y = nextY;
+                player.isOnGround = false;
+            }
+        }
+    }
+    // Jumping upward
+    else if (player.velocityY < 0) {
+        for (int i = 0; i < -player.velocityY; i++) {
+            int nextY = player.y - 1;
 
             if (nextY < 0) {
                 player.velocityY = 0;
@@ -568,24 +1972,7 @@ void performAttack(char direction) {
         currentAttack.framesRemaining = ATTACK_DURATION_LONG;
 
         // Position attack relative to player based on direction
-        switch (direction) {
-            case 'i': // Up
-                currentAttack.x = player.x - 1;
-                currentAttack.y = player.y - 2;
-                break;
-            case 'j': // Left
-                currentAttack.x = player.x - 2;
-                currentAttack.y = player.y - 1;
-                break;
-            case 'k': // Down
-                currentAttack.x = player.x - 1;
-                currentAttack.y = player.y + 1;
-                break;
-            case 'l': // Right
-                currentAttack.x = player.x + 1;
-                currentAttack.y = player.y - 1;
-                break;
-        }
+        getAttackOrigin(direction, player.x, player.y, currentAttack.x, currentAttack.y);
 
         attackCooldown = ATTACK_COOLDOWN_FRAMES;
     }
@@ -595,24 +1982,7 @@ void performAttack(char direction) {
         currentAttack.framesRemaining = ATTACK_DURATION_SHORT;
 
         // Set attack position based on direction
-        switch (direction) {
-            case 'i': // Up
-                currentAttack.x = player.x - 1;
-                currentAttack.y = player.y - 2;
-                break;
-            case 'j': // Left
-                currentAttack.x = player.x - 2;
-                currentAttack.y = player.y - 1;
-                break;
-            case 'k': // Down
-                currentAttack.x = player.x - 1;
-                currentAttack.y = player.y + 1;
-                break;
-            case 'l': // Right
-                currentAttack.x = player.x + 1;
-                currentAttack.y = player.y - 1;
-                break;
-        }
+        getAttackOrigin(direction, player.x, player.y, currentAttack.x, currentAttack.y);
 
         attackCooldown = 0;
     }
@@ -629,45 +1999,368 @@ void updateAttack() {
     if (combatStyle == 1 && attackCooldown > 0) {
         attackCooldown--;
     }
+    if (playerShotCooldown > 0) {
+        playerShotCooldown--;
+    }
 }
 
 // ========================================
 // CONSOLE & RENDERING SYSTEM
 // ========================================
 
+#ifndef _WIN32
+// The first interrupt asks the running loop to stop, so the journal, the
+// recording and the spectator feed are closed as usual. A second one means
+// the shutdown is stuck: restore the terminal and leave at once -
+// async-signal-safe calls only, a half-written frame is simply abandoned.
+void handleInterrupt(int) {
+    if (!quitRequested) {
+        quitRequested = 1;
+        return;
+    }
+
+    restoreTerminalState();
+
+    // Spectators stop instead of waiting for frames that never come
+    if (spectatorFeed != nullptr) {
+        spectatorFeed->isLive.store(0, std::memory_order_release);
+    }
+    _exit(1);
+}
+
+// The next frame picks the layout for the new size
+void handleResize(int) {
+    terminalResized = 1;
+}
+#endif
+
+// Switch the terminal to unbuffered, no-echo input
+void initializeConsole() {
+#ifdef _WIN32
+    // Replays and spectating emit ANSI escapes
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(console, &mode)) {
+        SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#else
+    if (tcgetattr(STDIN_FILENO, &originalTermios) == 0) {
+        termiosSaved = true;
+
+        struct termios raw = originalTermios;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    // Read once - pumpOutput() switches O_NONBLOCK on around its writes
+    stdoutFlags = fcntl(STDOUT_FILENO, F_GETFL);
+    if (stdoutFlags >= 0) {
+        stdoutFlags &= ~O_NONBLOCK;
+    }
+    // No SA_RESTART - an interrupt ends a blocking readKey() in the menus
+    struct sigaction interrupt;
+    memset(&interrupt, 0, sizeof(interrupt));
+    interrupt.sa_handler = handleInterrupt;
+    sigemptyset(&interrupt.sa_mask);
+    sigaction(SIGINT, &interrupt, nullptr);
+    sigaction(SIGTERM, &interrupt, nullptr);
+    signal(SIGWINCH, handleResize);
+#endif
+}
+
+// Give the terminal back in the state we found it
+void restoreConsole() {
+#ifndef _WIN32
+    finishOutput();
+    cout.flush();
+    restoreTerminalState();
+#endif
+}
+
+// Colors, cursor, blocking output and input mode - only fcntl(), write() and
+// tcsetattr(), so the interrupt handler can call it too
+void restoreTerminalState() {
+#ifndef _WIN32
+    // stdout shares its file description with the shell - never leave it non-blocking
+    if (stdoutFlags >= 0) {
+        fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags);
+    }
+
+    const char reset[] = "\x1b[0m\x1b[?25h";
+    if (write(STDOUT_FILENO, reset, sizeof(reset) - 1) < 0) {
+        // Nothing left to do if the terminal is gone
+    }
+    if (termiosSaved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &originalTermios);
+    }
+#endif
+}
+
+// Non-blocking check for a pending key
+bool keyPressed() {
+#ifdef _WIN32
+    return _kbhit() != 0;
+#else
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(STDIN_FILENO, &readSet);
+    struct timeval timeout = {0, 0};
+    if (select(STDIN_FILENO + 1, &readSet, nullptr, nullptr, &timeout) <= 0) return false;
+
+    if (inputArrivalTime < 0) {
+        inputArrivalTime = nowMicroseconds();
+    }
+    return true;
+#endif
+}
+
+// Blocking single key read without echo. Never waits on stdout - text
+// prompts flush their own output before asking for a key.
+char readKey() {
+#ifdef _WIN32
+    lastKeyArrival = nowMicroseconds();
+    return (char)_getch();
+#else
+    char ch = 0;
+    bool received = read(STDIN_FILENO, &ch, 1) == 1;
+
+    // A key that was waiting since a sleep counts from then - more buffered
+    // keys are stamped again by the next sleepMs()/keyPressed()
+    lastKeyArrival = (inputArrivalTime >= 0) ? inputArrivalTime : nowMicroseconds();
+    inputArrivalTime = -1;
+
+    if (!received) {
+        return 27; // Treat closed input as ESC
+    }
+    return ch;
+#endif
+}
+
+void sleepMs(int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    cout.flush();
+
+    // Spend the wait pushing out a frame the terminal couldn't take at once,
+    // and note when a key arrives so its latency includes the time it waits here
+    long long end = nowMicroseconds() + milliseconds * 1000LL;
+    while (true) {
+        bool writing = !pumpOutput();
+        long long left = end - nowMicroseconds();
+        if (left <= 0 || quitRequested) return;
+
+        fd_set readSet, writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        if (inputArrivalTime < 0) {
+            FD_SET(STDIN_FILENO, &readSet);
+        }
+        if (writing) {
+            FD_SET(STDOUT_FILENO, &writeSet);
+        }
+
+        struct timeval timeout = {(time_t)(left / 1000000), (suseconds_t)(left % 1000000)};
+        int maxFd = (STDIN_FILENO > STDOUT_FILENO) ? STDIN_FILENO : STDOUT_FILENO;
+        if (select(maxFd + 1, &readSet, &writeSet, nullptr, &timeout) > 0 && FD_ISSET(STDIN_FILENO, &readSet)) {
+            inputArrivalTime = nowMicroseconds();
+        }
+    }
+#endif
+}
+
+void clearScreen() {
+#ifdef _WIN32
+    system("cls");
+#else
+    finishOutput();
+    cout << "\x1b[2J\x1b[H" << flush;
+#endif
+}
+
 void moveCursorToTopLeft() {
+#ifdef _WIN32
     COORD pos = {0, 0};
     SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), pos);
+#else
+    cout << "\x1b[H";
+#endif
 }
 
 void hideCursor() {
+#ifdef _WIN32
     HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
     CONSOLE_CURSOR_INFO info;
     GetConsoleCursorInfo(console, &info);
     info.bVisible = false;
     SetConsoleCursorInfo(console, &info);
+#else
+    cout << "\x1b[?25l";
+#endif
+}
+
+// Append raw bytes to the frame buffer
+void appendFrame(const char* text, int length) {
+    if (frameLength + length > FRAME_BUFFER_SIZE) return;
+    memcpy(frameBuffer + frameLength, text, length);
+    frameLength += length;
+}
+
+// Send the finished frame to the terminal, normally in a single write. The
+// part a slow terminal or pipe doesn't take stays pending for pumpOutput().
+void flushFrame() {
+#ifdef _WIN32
+    cout.write(frameBuffer, frameLength);
+#else
+    cout.flush();
+    outputPendingLength = frameLength;
+    outputOffset = 0;
+    outputFramesSent++;
+    outputWindowFrames++;
+    pumpOutput();
+#endif
+    frameLength = 0;
+}
+
+// Write as much of the pending frame as the terminal takes without blocking.
+// Returns true once nothing is pending, frameBuffer is free for the next frame.
+bool pumpOutput() {
+#ifdef _WIN32
+    return true;
+#else
+    if (outputOffset >= outputPendingLength) return true;
+
+    // Non-blocking only for these writes - stdin often shares the flag.
+    // The saved flags are used, not the current ones, which an interrupted
+    // pump could have left non-blocking
+    if (stdoutFlags < 0) {
+        stdoutFlags = fcntl(STDOUT_FILENO, F_GETFL);
+        if (stdoutFlags < 0) {
+            outputOffset = outputPendingLength; // Not a usable descriptor, drop the frame
+            return true;
+        }
+        stdoutFlags &= ~O_NONBLOCK;
+    }
+    int flags = stdoutFlags;
+    fcntl(STDOUT_FILENO, F_SETFL, flags | O_NONBLOCK);
+
+    while (outputOffset < outputPendingLength) {
+        ssize_t result = write(STDOUT_FILENO, frameBuffer + outputOffset, outputPendingLength - outputOffset);
+        outputWrites++;
+        outputWindowWrites++;
+
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            outputStalls++;
+            break;
+        }
+        if (result <= 0) {
+            outputOffset = outputPendingLength; // Terminal is gone, drop the frame
+            break;
+        }
+        outputOffset += (int)result;
+        outputBytes += result;
+        outputWindowBytes += result;
+    }
+
+    fcntl(STDOUT_FILENO, F_SETFL, flags);
+    return outputOffset >= outputPendingLength;
+#endif
+}
+
+// Block until the pending frame is out - before other text goes to the terminal
+void finishOutput() {
+#ifndef _WIN32
+    while (!pumpOutput()) {
+        fd_set writeSet;
+        FD_ZERO(&writeSet);
+        FD_SET(STDOUT_FILENO, &writeSet);
+        select(STDOUT_FILENO + 1, nullptr, &writeSet, nullptr, nullptr);
+    }
+#endif
 }
 
 // Main render function - displays HUD and arena
 void render() {
+    composeFrame();
+    publishSpectatorFrame();
+    recordFrame();
+
+    if (headlessMode) return;
+
+#ifdef _WIN32
+    if (!minimapLayoutReady) {
+        updateMinimapLayout();
+    }
+    moveCursorToTopLeft();
+    renderHUD();
+    if (minimapBlockWidth > 0) {
+        renderMinimap();
+    } else {
+        renderArena();
+    }
+#else
+    updateOutputStats();
+
+    // The terminal hasn't taken the last frame yet - drop this one, the
+    // next full frame shows its changes too, and the simulation never waits
+    if (!pumpOutput()) {
+        outputFramesSkipped++;
+        outputWindowSkipped++;
+        lastFrameComplete = false;
+        return;
+    }
+
+    frameLength = 0;
+    appendFrame("\x1b[H", 3);
+
+    // New terminal size - the old picture may not be overwritten everywhere
+    if (!minimapLayoutReady || terminalResized) {
+        terminalResized = 0;
+        if (updateMinimapLayout()) {
+            appendFrame("\x1b[2J", 4);
+        }
+    }
+
     renderHUD();
-    renderArena();
+    if (minimapBlockWidth > 0) {
+        renderMinimap();
+    } else {
+        renderArena();
+    }
+    flushFrame();
+    lastFrameComplete = (outputOffset >= outputPendingLength);
+#endif
 }
 
 // Render the heads-up display (HP and wave info)
 void renderHUD() {
+#ifdef _WIN32
     cout << "HP: " << player.hp << " | Wave: " << currentWave << "/" << MAX_WAVES << "\n";
+#else
+    char line[160];
+    int length = snprintf(line, sizeof(line), "HP: %d | Wave: %d/%d", player.hp, currentWave, MAX_WAVES);
+    if (outputStats) {
+        length += snprintf(line + length, sizeof(line) - length,
+                           " | out %d KB/s %d fps, %d skipped/s, %.1f writes/frame",
+                           outputBytesPerSecond / 1024, outputFramesPerSecond, outputSkippedPerSecond,
+                           outputWritesPerFrame);
+    }
+    length += snprintf(line + length, sizeof(line) - length, "\x1b[K\n");
+    appendFrame(line, length);
+#endif
 }
 
 // Render the entire game arena
 void renderArena() {
+#ifdef _WIN32
     for (int i = 0; i < ARENA_HEIGHT; i++) {
         for (int j = 0; j < ARENA_WIDTH; j++) {
-            bool shouldColor = false;
-            char colorChar = ' ';
-            char ch = getCharAtPosition(i, j, shouldColor, colorChar);
+            char ch = (char)composedGlyph[i * ARENA_WIDTH + j];
+            char colorChar = (char)composedColor[i * ARENA_WIDTH + j];
 
-            if (shouldColor) {
+            if (colorChar != 0) {
                 setColorForEnemy(colorChar);
                 cout << ch;
                 resetConsoleColor();
@@ -677,134 +2370,409 @@ void renderArena() {
         }
         cout << '\n';
     }
+#else
+    appendArenaCells(composedGlyph, composedColor);
+#endif
 }
 
-// Determine which character should be displayed at position (i, j)
-char getCharAtPosition(int i, int j, bool& shouldColor, char& colorChar) {
-    char ch = ' ';
+// Append a full arena of cells to the frame buffer as ANSI text
+// Same-color neighbours share one escape sequence
+void appendArenaCells(const unsigned char* glyphs, const unsigned char* colors) {
+    char currentColor = ' ';
 
-    // Try to render attack first (highest priority)
-    if (tryRenderAttack(i, j, ch)) {
-        return ch;
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        for (int j = 0; j < ARENA_WIDTH; j++) {
+            char ch = (char)glyphs[i * ARENA_WIDTH + j];
+            char colorChar = (char)colors[i * ARENA_WIDTH + j];
+
+            char cellColor = (colorChar != 0) ? colorChar : ' ';
+            if (cellColor != currentColor) {
+                const char* escape = ansiColorForEnemy(cellColor);
+                appendFrame(escape, (int)strlen(escape));
+                currentColor = cellColor;
+            }
+            appendFrame(&ch, 1);
+        }
+        appendFrame("\n", 1);
     }
 
-    // Try to render enemy second
-    if (tryRenderEnemy(i, j, ch, colorChar)) {
-        shouldColor = true;
-        return ch;
+    if (currentColor != ' ') {
+        appendFrame("\x1b[0m", 4);
     }
+}
+
+// ========================================
+// FRAME COMPOSITOR
+// ========================================
 
-    // Render player
-    if (i == player.y && j == player.x) {
-        return '@';
+// Each system rasterizes its own layer once per frame, then layers are
+// blended bottom to top: terrain, overlay, entities, attack.
+// Only rows touched this frame or the previous one are recomposed.
+void composeFrame() {
+    // Rows covered last frame must be recomposed to erase old glyphs
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        rowNeedsCompose[i] = overlayLayer.rowTouched[i] || entityLayer.rowTouched[i] ||
+                             attackLayer.rowTouched[i];
     }
 
-    // Default to arena tiles
-    return arena[i][j];
-}
+    clearLayer(overlayLayer);
+    clearLayer(entityLayer);
+    clearLayer(attackLayer);
 
-// Try to render attack at position - returns true if attack rendered
-bool tryRenderAttack(int i, int j, char& outChar) {
-    if (!currentAttack.isActive) {
-        return false;
+    rasterizeTerrainLayer();
+    rasterizeOverlayLayer();
+    rasterizeEntityLayer();
+    rasterizeAttackLayer();
+
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        if (!rowNeedsCompose[i]) continue;
+
+        int rowStart = i * ARENA_WIDTH;
+        memcpy(composedGlyph + rowStart, terrainLayer.glyph + rowStart, ARENA_WIDTH);
+        memset(composedColor + rowStart, 0, ARENA_WIDTH);
+
+        blendLayerRow(overlayLayer, i);
+        blendLayerRow(entityLayer, i);
+        blendLayerRow(attackLayer, i);
     }
+}
 
-    // Attack upward (3-char horizontal: /-\)
-    if (currentAttack.direction == 'i' && i == currentAttack.y) {
-        if (j == currentAttack.x) {
-            outChar = '/';
-            return true;
-        } else if (j == currentAttack.x + 1) {
-            outChar = '-';
-            return true;
-        } else if (j == currentAttack.x + 2) {
-            outChar = '\\';
-            return true;
-        }
+// Make every cell the layer wrote last frame transparent again
+void clearLayer(FrameLayer& layer) {
+    for (int t = 0; t < layer.touchedCount; t++) {
+        layer.mask[layer.touched[t]] = 0;
     }
-    // Attack left (3-char vertical)
-    else if (currentAttack.direction == 'j' && j == currentAttack.x) {
-        if (i == currentAttack.y) {
-            outChar = '/';
-            return true;
-        } else if (i == currentAttack.y + 1) {
-            outChar = '|';
-            return true;
-        } else if (i == currentAttack.y + 2) {
-            outChar = '\\';
-            return true;
-        }
+    layer.touchedCount = 0;
+
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        layer.rowTouched[i] = false;
     }
-    // Attack downward (3-char horizontal: \_/)
-    else if (currentAttack.direction == 'k' && i == currentAttack.y) {
-        if (j == currentAttack.x) {
-            outChar = '\\';
-            return true;
-        } else if (j == currentAttack.x + 1) {
-            outChar = '_';
-            return true;
-        } else if (j == currentAttack.x + 2) {
-            outChar = '/';
-            return true;
-        }
+}
+
+// Write one cell into a layer - without overwrite the first writer keeps the cell
+void stampLayer(FrameLayer& layer, int x, int y, char glyph, char color, bool overwrite) {
+    if (x < 0 || x >= ARENA_WIDTH || y < 0 || y >= ARENA_HEIGHT) return;
+
+    int cell = y * ARENA_WIDTH + x;
+    if (layer.mask[cell]) {
+        if (!overwrite) return;
+    } else {
+        layer.touched[layer.touchedCount++] = cell;
     }
-    // Attack right (3-char vertical)
-    else if (currentAttack.direction == 'l' && j == currentAttack.x) {
-        if (i == currentAttack.y) {
-            outChar = '\\';
-            return true;
-        } else if (i == currentAttack.y + 1) {
-            outChar = '|';
-            return true;
-        } else if (i == currentAttack.y + 2) {
-            outChar = '/';
-            return true;
+
+    layer.glyph[cell] = (unsigned char)glyph;
+    layer.color[cell] = (unsigned char)color;
+    layer.mask[cell] = 0xFF;
+    layer.rowTouched[y] = true;
+    rowNeedsCompose[y] = true;
+}
+
+// composed = (composed & ~mask) | (layer & mask), 8 cells per word
+void blendLayerRow(const FrameLayer& layer, int row) {
+    if (!layer.rowTouched[row]) return;
+
+    int rowStart = row * ARENA_WIDTH;
+    for (int j = 0; j < ARENA_WIDTH; j += 8) {
+        unsigned long long mask, glyph, color, outGlyph, outColor;
+        memcpy(&mask, layer.mask + rowStart + j, 8);
+        if (mask == 0) continue;
+
+        memcpy(&glyph, layer.glyph + rowStart + j, 8);
+        memcpy(&color, layer.color + rowStart + j, 8);
+        memcpy(&outGlyph, composedGlyph + rowStart + j, 8);
+        memcpy(&outColor, composedColor + rowStart + j, 8);
+
+        outGlyph = (outGlyph & ~mask) | (glyph & mask);
+        outColor = (outColor & ~mask) | (color & mask);
+
+        memcpy(composedGlyph + rowStart + j, &outGlyph, 8);
+        memcpy(composedColor + rowStart + j, &outColor, 8);
+    }
+}
+
+// Static tiles - cached, only edited cells are copied again
+void rasterizeTerrainLayer() {
+    if (terrainLayerDirty) {
+        renderX0 = 0;
+        renderY0 = 0;
+        renderX1 = ARENA_WIDTH - 1;
+        renderY1 = ARENA_HEIGHT - 1;
+        terrainLayerDirty = false;
+    }
+    if (renderX0 > renderX1) return;
+
+    for (int i = renderY0; i <= renderY1; i++) {
+        for (int j = renderX0; j <= renderX1; j++) {
+            int cell = i * ARENA_WIDTH + j;
+            terrainLayer.glyph[cell] = (unsigned char)arena[i][j];
+            terrainLayer.color[cell] = 0;
+            terrainLayer.mask[cell] = 0xFF;
         }
+        rowNeedsCompose[i] = true;
     }
+    renderX0 = ARENA_WIDTH;
+    renderY0 = ARENA_HEIGHT;
+    renderX1 = renderY1 = -1;
+}
 
-    return false;
+// Boss AOE warning during windup (11x11 area, empty tiles only)
+void rasterizeOverlayLayer() {
+    for (int e = 0; e < enemyCount; e++) {
+        if (!enemies[e].isActive || enemies[e].type != 'B' || enemies[e].attackState != 1) continue;
+
+        for (int i = enemies[e].y - BOSS_AOE_RANGE; i <= enemies[e].y + BOSS_AOE_RANGE; i++) {
+            for (int j = enemies[e].x - BOSS_AOE_RANGE; j <= enemies[e].x + BOSS_AOE_RANGE; j++) {
+                if (i < 0 || i >= ARENA_HEIGHT || j < 0 || j >= ARENA_WIDTH) continue;
+                if (arena[i][j] == ' ') {
+                    stampLayer(overlayLayer, j, i, '*', 'B', false);
+                }
+            }
+        }
+    }
 }
 
-// Try to render enemy at position - returns true if enemy rendered
-bool tryRenderEnemy(int i, int j, char& outChar, char& colorChar) {
+// Enemies in array order (first one wins a shared cell), then the player
+void rasterizeEntityLayer() {
     for (int e = 0; e < enemyCount; e++) {
         if (!enemies[e].isActive) continue;
 
-        // Boss is 3x3, centered at (x, y)
-        if (enemies[e].type == 'B') {
-            // Render Boss body (3x3)
-            if (j >= enemies[e].x - 1 && j <= enemies[e].x + 1 &&
-                i >= enemies[e].y - 1 && i <= enemies[e].y + 1) {
-                outChar = 'B';
-                colorChar = 'B';
-                return true;
+        // Footprint is centered at (x, y)
+        const EnemyTraits& traits = traitsOf(enemies[e].type);
+        for (int dy = -traits.halfHeight; dy <= traits.halfHeight; dy++) {
+            for (int dx = -traits.halfWidth; dx <= traits.halfWidth; dx++) {
+                stampLayer(entityLayer, enemies[e].x + dx, enemies[e].y + dy,
+                           traits.glyph, enemies[e].type, false);
+            }
+        }
+    }
+
+    stampLayer(entityLayer, player.x, player.y, '@', 0, false);
+}
+
+// Active attack glyphs (highest priority)
+void rasterizeAttackLayer() {
+    rasterizeProjectiles();
+    if (!currentAttack.isActive) return;
+
+    int x = currentAttack.x;
+    int y = currentAttack.y;
+
+    switch (currentAttack.direction) {
+        case 'i': // Up (3-char horizontal: /-\)
+            stampLayer(attackLayer, x, y, '/', 0, true);
+            stampLayer(attackLayer, x + 1, y, '-', 0, true);
+            stampLayer(attackLayer, x + 2, y, '\\', 0, true);
+            break;
+        case 'j': // Left (3-char vertical)
+            stampLayer(attackLayer, x, y, '/', 0, true);
+            stampLayer(attackLayer, x, y + 1, '|', 0, true);
+            stampLayer(attackLayer, x, y + 2, '\\', 0, true);
+            break;
+        case 'k': // Down (3-char horizontal: \_/)
+            stampLayer(attackLayer, x, y, '\\', 0, true);
+            stampLayer(attackLayer, x + 1, y, '_', 0, true);
+            stampLayer(attackLayer, x + 2, y, '/', 0, true);
+            break;
+        case 'l': // Right (3-char vertical)
+            stampLayer(attackLayer, x, y, '\\', 0, true);
+            stampLayer(attackLayer, x, y + 1, '|', 0, true);
+            stampLayer(attackLayer, x, y + 2, '/', 0, true);
+            break;
+    }
+}
+
+// ========================================
+// MINIMAP
+// ========================================
+
+// When the terminal is smaller than the arena (or with --minimap) every
+// terminal cell stands for a block of arena cells. Blocks are reduced from
+// bit planes 64 cells per word - enemy positions per type and the solidity
+// bits - so a frame costs the same however many enemies share a block.
+
+// Visible terminal size - false if it can't be told (not a terminal)
+bool queryTerminalSize(int& columns, int& rows) {
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) return false;
+    columns = info.srWindow.Right - info.srWindow.Left + 1;
+    rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    return true;
+#else
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 || size.ws_row == 0) return false;
+    columns = size.ws_col;
+    rows = size.ws_row;
+    return true;
+#endif
+}
+
+// Pick the block size for the current terminal - true if the layout changed
+bool updateMinimapLayout() {
+    int blockWidth = 0;
+    int blockHeight = 0;
+    int columns = 0;
+    int rows = 0;
+
+    // Full size needs the HUD line, the arena rows and the newline after the last one
+    if (queryTerminalSize(columns, rows) && (columns < ARENA_WIDTH || rows < ARENA_HEIGHT + 2)) {
+        int mapRows = (rows > 2) ? rows - 1 : 1;
+        blockWidth = (ARENA_WIDTH + columns - 1) / columns;
+        blockHeight = (ARENA_HEIGHT + mapRows - 1) / mapRows;
+    } else if (minimapForced) {
+        blockWidth = MINIMAP_BLOCK_WIDTH;
+        blockHeight = MINIMAP_BLOCK_HEIGHT;
+    }
+
+    bool changed = !minimapLayoutReady || blockWidth != minimapBlockWidth || blockHeight != minimapBlockHeight;
+    minimapLayoutReady = true;
+    minimapBlockWidth = blockWidth;
+    minimapBlockHeight = blockHeight;
+    if (blockWidth > 0) {
+        minimapWidth = (ARENA_WIDTH + blockWidth - 1) / blockWidth;
+        minimapHeight = (ARENA_HEIGHT + blockHeight - 1) / blockHeight;
+    }
+    return changed;
+}
+
+int countBits(unsigned long long value) {
+#ifdef __GNUC__
+    return __builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Set bits inside x0..x1, y0..y1 - one masked popcount per row and word
+int countBlockBits(const unsigned long long bits[ARENA_HEIGHT][SOLID_WORDS], int x0, int y0, int x1, int y1) {
+    int count = 0;
+    for (int w = x0 / 64; w <= x1 / 64; w++) {
+        int from = (x0 > w * 64) ? x0 - w * 64 : 0;
+        int to = (x1 < w * 64 + 63) ? x1 - w * 64 : 63;
+        unsigned long long mask = (~0ULL >> (63 - to)) & (~0ULL << from);
+
+        for (int y = y0; y <= y1; y++) {
+            count += countBits(bits[y][w] & mask);
+        }
+    }
+    return count;
+}
+
+// One bit per occupied enemy position (footprint centre), per type
+void buildEnemyTypeBits() {
+    memset(enemyTypeBits, 0, sizeof(enemyTypeBits));
+
+    for (int i = 0; i < enemyCount; i++) {
+        const Enemy& enemy = enemies[i];
+        if (!enemy.isActive || enemy.x < 0 || enemy.x >= ARENA_WIDTH || enemy.y < 0 || enemy.y >= ARENA_HEIGHT) {
+            continue;
+        }
+
+        for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+            if (ENEMY_TRAITS[k].type == enemy.type) {
+                enemyTypeBits[k][enemy.y][enemy.x / 64] |= 1ULL << (enemy.x % 64);
+                break;
             }
+        }
+    }
+}
 
-            // Boss AOE warning during windup (11x11 area)
-            if (enemies[e].attackState == 1) {
-                if (j >= enemies[e].x - 5 && j <= enemies[e].x + 5 &&
-                    i >= enemies[e].y - 5 && i <= enemies[e].y + 5) {
-                    // Only show * in empty positions
-                    if (arena[i][j] == ' ' &&
-                        !(j >= enemies[e].x - 1 && j <= enemies[e].x + 1 &&
-                          i >= enemies[e].y - 1 && i <= enemies[e].y + 1) &&
-                        !(i == player.y && j == player.x)) {
-                        outChar = '*';
-                        colorChar = 'B';
-                        return true;
-                    }
+// Player '@' first, then the enemy count (1-9, '+' above) in the color of
+// the most common type, otherwise a shade for the block's solid tiles
+void composeMinimap() {
+    buildEnemyTypeBits();
+
+    for (int row = 0; row < minimapHeight; row++) {
+        int y0 = row * minimapBlockHeight;
+        int y1 = (y0 + minimapBlockHeight < ARENA_HEIGHT) ? y0 + minimapBlockHeight - 1 : ARENA_HEIGHT - 1;
+
+        for (int column = 0; column < minimapWidth; column++) {
+            int x0 = column * minimapBlockWidth;
+            int x1 = (x0 + minimapBlockWidth < ARENA_WIDTH) ? x0 + minimapBlockWidth - 1 : ARENA_WIDTH - 1;
+            int cell = row * minimapWidth + column;
+
+            int total = 0;
+            int busiestKind = 0;
+            int busiestCount = 0;
+            for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+                int count = countBlockBits(enemyTypeBits[k], x0, y0, x1, y1);
+                total += count;
+                if (count > busiestCount) {
+                    busiestCount = count;
+                    busiestKind = k;
                 }
             }
+
+            if (player.x >= x0 && player.x <= x1 && player.y >= y0 && player.y <= y1) {
+                minimapGlyph[cell] = '@';
+                minimapColor[cell] = 0;
+            } else if (total > 0) {
+                minimapGlyph[cell] = (unsigned char)((total <= 9) ? '0' + total : '+');
+                minimapColor[cell] = (unsigned char)ENEMY_TRAITS[busiestKind].type;
+            } else {
+                int cells = (x1 - x0 + 1) * (y1 - y0 + 1);
+                int solid = countBlockBits(solidBits, x0, y0, x1, y1);
+                minimapGlyph[cell] = (unsigned char)MINIMAP_TERRAIN_SHADES[(solid * 4 + cells - 1) / cells];
+                minimapColor[cell] = 0;
+            }
         }
-        // Normal 1x1 enemies
-        else if (enemies[e].x == j && enemies[e].y == i) {
-            outChar = enemies[e].type;
-            colorChar = enemies[e].type;
-            return true;
+    }
+}
+
+// Draw the minimap below the HUD - rows are shorter than the terminal, so
+// each one clears the rest of its line, and the last one what is below it
+void renderMinimap() {
+    composeMinimap();
+
+#ifdef _WIN32
+    for (int row = 0; row < minimapHeight; row++) {
+        for (int column = 0; column < minimapWidth; column++) {
+            char ch = (char)minimapGlyph[row * minimapWidth + column];
+            char colorChar = (char)minimapColor[row * minimapWidth + column];
+
+            if (colorChar != 0) {
+                setColorForEnemy(colorChar);
+                cout << ch;
+                resetConsoleColor();
+            } else {
+                cout << ch;
+            }
+        }
+        if (row < minimapHeight - 1) {
+            cout << '\n';
         }
     }
+#else
+    char currentColor = ' ';
+
+    for (int row = 0; row < minimapHeight; row++) {
+        for (int column = 0; column < minimapWidth; column++) {
+            char ch = (char)minimapGlyph[row * minimapWidth + column];
+            char colorChar = (char)minimapColor[row * minimapWidth + column];
+
+            char cellColor = (colorChar != 0) ? colorChar : ' ';
+            if (cellColor != currentColor) {
+                const char* escape = ansiColorForEnemy(cellColor);
+                appendFrame(escape, (int)strlen(escape));
+                currentColor = cellColor;
+            }
+            appendFrame(&ch, 1);
+        }
 
-    return false;
+        if (row < minimapHeight - 1) {
+            appendFrame("\x1b[K\n", 4);
+        } else {
+            appendFrame("\x1b[J", 3);
+        }
+    }
+
+    if (currentColor != ' ') {
+        appendFrame("\x1b[0m", 4);
+    }
+#endif
 }
 
 // ========================================
@@ -817,8 +2785,14 @@ void initializeEnemies() {
     enemyCount = 0;
 }
 
-// Add a new enemy to the arena - dynamically expands array if needed
+// Add a new enemy to the arena with its timers counting from this tick
 void addEnemy(char type, int x, int y) {
+    int index = placeEnemy(type, x, y);
+    scheduleEnemyTimers(enemies[index], -1, -1);
+}
+
+// Append a fresh enemy without timers - dynamically expands array if needed
+int placeEnemy(char type, int x, int y) {
     // Expand array if capacity reached (double the size)
     if (enemyCount >= enemyCapacity) {
         int newCapacity = enemyCapacity * 2;
@@ -836,34 +2810,71 @@ void addEnemy(char type, int x, int y) {
     enemies[enemyCount].type = type;
     enemies[enemyCount].x = x;
     enemies[enemyCount].y = y;
-    enemies[enemyCount].hp = (type == 'B') ? BOSS_MAX_HP : 1;
+    enemies[enemyCount].hp = traitsOf(type).startHp;
     enemies[enemyCount].velocityX = (rand() % 2 == 0) ? 1 : -1;
     enemies[enemyCount].velocityY = 0;
     enemies[enemyCount].isActive = true;
     enemies[enemyCount].isOnGround = false;
-    enemies[enemyCount].aiTimer = 0;
+    enemies[enemyCount].descentDue = false;
     enemies[enemyCount].surface = 'f';
     enemies[enemyCount].edgeWrapStep = 0;
     enemies[enemyCount].attackState = 0;
-    enemies[enemyCount].windupTimer = 0;
-    enemyCount++;
+    enemies[enemyCount].sweepX = x;
+    enemies[enemyCount].sweepTop = 0;
+    enemies[enemyCount].sweepBottom = -1;
+    enemies[enemyCount].isOnArc = false;
+    enemies[enemyCount].arcDirection = 0;
+    enemies[enemyCount].alertTimer = 0;
+    enemies[enemyCount].parkedTimers = -1;
+    logEvent(EVENT_SPAWN, type, x, y, enemies[enemyCount].hp);
+
+    // Ids are never reused, so a stale timer can't wake the wrong enemy
+    if (nextEnemyId >= enemyIdCapacity) {
+        int newCapacity = (enemyIdCapacity == 0) ? 64 : enemyIdCapacity * 2;
+        int* newIndex = new int[newCapacity];
+        for (int i = 0; i < nextEnemyId; i++) {
+            newIndex[i] = enemyIndexById[i];
+        }
+        delete[] enemyIndexById;
+        enemyIndexById = newIndex;
+        enemyIdCapacity = newCapacity;
+    }
+    enemies[enemyCount].id = nextEnemyId;
+    enemyIndexById[nextEnemyId] = enemyCount;
+    nextEnemyId++;
+    return enemyCount++;
 }
 
-void removeEnemy(int index) {
-    if (index < 0 || index >= enemyCount) return;
-
-    // Shift all enemies after this one back
-    for (int i = index; i < enemyCount - 1; i++) {
-        enemies[i] = enemies[i + 1];
+// Timed behaviors start counting from the first AI update (this tick).
+// timer is the delay to the next Flier descent or Boss state change and
+// shotTimer the delay to the next Flier shot, -1 picks the spawn default.
+void scheduleEnemyTimers(const Enemy& enemy, int timer, int shotTimer) {
+    if (enemy.type == 'F') {
+        scheduleTimer(enemy.id, TIMER_FLIER_DESCENT, (timer < 0) ? FLIER_DESCENT_INTERVAL - 1 : timer);
+        scheduleTimer(enemy.id, TIMER_FLIER_SHOT, (shotTimer < 0) ? FLIER_SHOT_INTERVAL : shotTimer);
+    } else if (enemy.type == 'B') {
+        // The timer that ends the current attack state
+        if (enemy.attackState == 1) {
+            scheduleTimer(enemy.id, TIMER_BOSS_TRIGGER, (timer < 0) ? BOSS_WINDUP_TIME : timer);
+        } else if (enemy.attackState == 2) {
+            scheduleTimer(enemy.id, TIMER_BOSS_BLAST, (timer < 0) ? 1 : timer);
+        } else {
+            scheduleTimer(enemy.id, TIMER_BOSS_WINDUP, (timer < 0) ? BOSS_ATTACK_INTERVAL - 1 : timer);
+        }
     }
-    enemyCount--;
 }
 
+
 // ========================================
 // ENEMY PHYSICS
 // ========================================
 
+// Vertical movement for one enemy kind - footprint loops are unrolled per type
+template <char Type>
 void applyEnemyGravity(Enemy& enemy) {
+    constexpr int halfWidth = traitsOf(Type).halfWidth;
+    constexpr int halfHeight = traitsOf(Type).halfHeight;
+
     enemy.velocityY += GRAVITY;
     if (enemy.velocityY > PLAYER_MAX_FALL_SPEED) {
         enemy.velocityY = PLAYER_MAX_FALL_SPEED;
@@ -874,21 +2885,9 @@ void applyEnemyGravity(Enemy& enemy) {
         // Falling
         for (int i = 0; i < enemy.velocityY; i++) {
             int nextY = enemy.y + 1;
-            bool collision = false;
-
-            // Boss is 3x3, check all bottom tiles
-            if (enemy.type == 'B') {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (isColliding(enemy.x + dx, nextY + 1)) {
-                        collision = true;
-                        break;
-                    }
-                }
-            } else {
-                collision = isColliding(enemy.x, nextY);
-            }
 
-            if (collision) {
+            // Any tile under the footprint's bottom row stops the fall
+            if (hasGroundUnder(enemy.x - halfWidth, enemy.x + halfWidth, nextY + halfHeight)) {
                 enemy.velocityY = 0;
                 enemy.isOnGround = true;
                 break;
@@ -896,71 +2895,349 @@ void applyEnemyGravity(Enemy& enemy) {
 
             enemy.y = nextY;
             enemy.isOnGround = false;
-
-            // --- Use centralized attack collision ---
-            if (currentAttack.isActive && isEnemyHitByAttack(enemy)) {
-                enemy.hp--;
-                if (enemy.hp <= 0) enemy.isActive = false;
-                currentAttack.isActive = false;
-            }
+            extendSweep(enemy);
         }
     }
     else if (enemy.velocityY < 0) {
         // Moving up (jumping)
         for (int i = 0; i < -enemy.velocityY; i++) {
             int nextY = enemy.y - 1;
-            bool collision = false;
-
-            // Boss 3x3 top collision
-            if (enemy.type == 'B') {
-                if (nextY - 1 < 0) collision = true;
-                else {
-                    for (int dx = -1; dx <= 1; dx++) {
-                        if (arena[nextY - 1][enemy.x + dx] == '#') {
-                            collision = true;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                if (nextY < 0 || arena[nextY][enemy.x] == '#') collision = true;
-            }
 
-            if (collision) {
+            // Only walls block upward movement, checked across the top row
+            if (isWallInSpan(enemy.x - halfWidth, enemy.x + halfWidth, nextY - halfHeight)) {
                 enemy.velocityY = 0;
                 break;
             }
 
             enemy.y = nextY;
             enemy.isOnGround = false;
-
-            // --- Use centralized attack collision ---
-            if (currentAttack.isActive && isEnemyHitByAttack(enemy)) {
-                enemy.hp--;
-                if (enemy.hp <= 0) enemy.isActive = false;
-                currentAttack.isActive = false;
-            }
+            extendSweep(enemy);
         }
     }
     else {
         // Not moving vertically, check if still on ground
-        bool hasGround = false;
+        if (!hasGroundUnder(enemy.x - halfWidth, enemy.x + halfWidth, enemy.y + halfHeight + 1)) {
+            enemy.isOnGround = false;
+        }
+    }
+}
 
-        if (enemy.type == 'B') {
-            for (int dx = -1; dx <= 1; dx++) {
-                if (isColliding(enemy.x + dx, enemy.y + 2)) {
-                    hasGround = true;
-                    break;
-                }
+// Remember the cells passed while falling or jumping, so the collision
+// stage can still catch an attack the enemy moved through
+void extendSweep(Enemy& enemy) {
+    if (enemy.sweepTop > enemy.sweepBottom) {
+        enemy.sweepX = enemy.x;
+        enemy.sweepTop = enemy.sweepBottom = enemy.y;
+        return;
+    }
+    if (enemy.y < enemy.sweepTop) enemy.sweepTop = enemy.y;
+    if (enemy.y > enemy.sweepBottom) enemy.sweepBottom = enemy.y;
+}
+
+// Physics step for one enemy kind - kinds without gravity compile to nothing
+template <char Type>
+void updateEnemyPhysics(Enemy& enemy) {
+    if constexpr (traitsOf(Type).hasGravity) {
+        applyEnemyGravity<Type>(enemy);
+    }
+}
+
+// ========================================
+// BATCH KERNELS
+// ========================================
+
+// Pick the widest kernel the CPU supports (scalar fallback otherwise)
+void selectBatchKernels() {
+    batchKernelLevel = KERNEL_SCALAR;
+#ifdef BATCH_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        batchKernelLevel = KERNEL_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        batchKernelLevel = KERNEL_SSE2;
+    }
+#endif
+}
+
+// Grow scratch arrays - padded to a multiple of 16 lanes so kernels never need a tail
+void ensureBatchCapacity(int capacity) {
+    int padded = (capacity + 15) / 16 * 16;
+    if (padded <= batchCapacity) return;
+
+    delete[] batchX;
+    delete[] batchY;
+    delete[] batchLeft;
+    delete[] batchRight;
+    delete[] batchTop;
+    delete[] batchBottom;
+    delete[] batchVelocityX;
+    delete[] batchOnGround;
+    delete[] batchSees;
+    delete[] batchMask;
+    delete[] planJump;
+
+    batchX = new short[padded];
+    batchY = new short[padded];
+    batchLeft = new short[padded];
+    batchRight = new short[padded];
+    batchTop = new short[padded];
+    batchBottom = new short[padded];
+    batchVelocityX = new short[padded];
+    batchOnGround = new short[padded];
+    batchSees = new short[padded];
+    batchMask = new unsigned char[padded];
+    planJump = new unsigned char[padded];
+    batchCapacity = padded;
+}
+
+// Copy enemy state into the SoA scratch arrays
+// Inactive enemies and padding lanes are parked far outside the arena
+void gatherEnemyBatch() {
+    ensureBatchCapacity(enemyCount);
+
+    for (int i = 0; i < batchCapacity; i++) {
+        if (i < enemyCount && enemies[i].isActive) {
+            batchX[i] = (short)enemies[i].x;
+            batchY[i] = (short)enemies[i].y;
+            const Enemy& enemy = enemies[i];
+            const EnemyTraits& traits = traitsOf(enemy.type);
+            int left = enemy.x - traits.halfWidth, right = enemy.x + traits.halfWidth;
+            int top = enemy.y - traits.halfHeight, bottom = enemy.y + traits.halfHeight;
+            if (enemy.sweepTop <= enemy.sweepBottom) {
+                if (enemy.sweepX - traits.halfWidth < left) left = enemy.sweepX - traits.halfWidth;
+                if (enemy.sweepX + traits.halfWidth > right) right = enemy.sweepX + traits.halfWidth;
+                if (enemy.sweepTop - traits.halfHeight < top) top = enemy.sweepTop - traits.halfHeight;
+                if (enemy.sweepBottom + traits.halfHeight > bottom) bottom = enemy.sweepBottom + traits.halfHeight;
             }
+            batchLeft[i] = (short)left;
+            batchRight[i] = (short)right;
+            batchTop[i] = (short)top;
+            batchBottom[i] = (short)bottom;
+            batchVelocityX[i] = (short)enemy.velocityX;
+            batchOnGround[i] = enemy.isOnGround ? -1 : 0;
         } else {
-            hasGround = isColliding(enemy.x, enemy.y + 1);
+            batchX[i] = -10000;
+            batchY[i] = -10000;
+            batchLeft[i] = batchRight[i] = -10000;
+            batchTop[i] = batchBottom[i] = -10000;
+            batchVelocityX[i] = 0;
+            batchOnGround[i] = 0;
+        }
+    }
+}
+
+// Scalar overlap test for lanes [from, to)
+void computeOverlapMaskScalar(int from, int to, int x0, int y0, int x1, int y1) {
+    for (int i = from; i < to; i++) {
+        batchMask[i] = (batchRight[i] >= x0 && batchLeft[i] <= x1 &&
+                        batchBottom[i] >= y0 && batchTop[i] <= y1) ? 1 : 0;
+    }
+}
+
+#ifdef BATCH_KERNELS_X86
+// 8 enemies per instruction
+void computeOverlapMaskSSE2(int x0, int y0, int x1, int y1) {
+    __m128i rx0 = _mm_set1_epi16((short)x0), rx1 = _mm_set1_epi16((short)x1);
+    __m128i ry0 = _mm_set1_epi16((short)y0), ry1 = _mm_set1_epi16((short)y1);
+    __m128i one = _mm_set1_epi8(1);
+
+    for (int i = 0; i < batchCapacity; i += 8) {
+        __m128i left = _mm_loadu_si128((const __m128i*)(batchLeft + i));
+        __m128i right = _mm_loadu_si128((const __m128i*)(batchRight + i));
+        __m128i top = _mm_loadu_si128((const __m128i*)(batchTop + i));
+        __m128i bottom = _mm_loadu_si128((const __m128i*)(batchBottom + i));
+
+        // Miss if any edge is separated
+        __m128i miss = _mm_cmpgt_epi16(rx0, right);
+        miss = _mm_or_si128(miss, _mm_cmpgt_epi16(left, rx1));
+        miss = _mm_or_si128(miss, _mm_cmpgt_epi16(ry0, bottom));
+        miss = _mm_or_si128(miss, _mm_cmpgt_epi16(top, ry1));
+
+        __m128i bytes = _mm_packs_epi16(miss, miss);
+        _mm_storel_epi64((__m128i*)(batchMask + i), _mm_andnot_si128(bytes, one));
+    }
+}
+
+// 16 enemies per instruction
+__attribute__((target("avx2")))
+void computeOverlapMaskAVX2(int x0, int y0, int x1, int y1) {
+    __m256i rx0 = _mm256_set1_epi16((short)x0), rx1 = _mm256_set1_epi16((short)x1);
+    __m256i ry0 = _mm256_set1_epi16((short)y0), ry1 = _mm256_set1_epi16((short)y1);
+    __m128i one = _mm_set1_epi8(1);
+
+    for (int i = 0; i < batchCapacity; i += 16) {
+        __m256i left = _mm256_loadu_si256((const __m256i*)(batchLeft + i));
+        __m256i right = _mm256_loadu_si256((const __m256i*)(batchRight + i));
+        __m256i top = _mm256_loadu_si256((const __m256i*)(batchTop + i));
+        __m256i bottom = _mm256_loadu_si256((const __m256i*)(batchBottom + i));
+
+        __m256i miss = _mm256_cmpgt_epi16(rx0, right);
+        miss = _mm256_or_si256(miss, _mm256_cmpgt_epi16(left, rx1));
+        miss = _mm256_or_si256(miss, _mm256_cmpgt_epi16(ry0, bottom));
+        miss = _mm256_or_si256(miss, _mm256_cmpgt_epi16(top, ry1));
+
+        // Pack works per 128-bit lane, so gather qwords 0 and 2 into the low half
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(miss, miss), 0x08);
+        _mm_storeu_si128((__m128i*)(batchMask + i),
+                         _mm_andnot_si128(_mm256_castsi256_si128(bytes), one));
+    }
+}
+#endif
+
+// batchMask[i] = 1 if enemy i's broad-phase box overlaps rectangle [x0..x1] x [y0..y1]
+// Call gatherEnemyBatch() first
+void computeOverlapMask(int x0, int y0, int x1, int y1) {
+#ifdef BATCH_KERNELS_X86
+    if (batchKernelLevel == KERNEL_AVX2) {
+        computeOverlapMaskAVX2(x0, y0, x1, y1);
+        return;
+    }
+    if (batchKernelLevel == KERNEL_SSE2) {
+        computeOverlapMaskSSE2(x0, y0, x1, y1);
+        return;
+    }
+#endif
+    computeOverlapMaskScalar(0, batchCapacity, x0, y0, x1, y1);
+}
+
+// Chase decision for lanes [from, to): new velocityX and jump flag
+void planChaseScalar(int from, int to) {
+    for (int i = from; i < to; i++) {
+        int dx = player.x - batchX[i];
+        int dy = player.y - batchY[i];
+        int adx = (dx < 0) ? -dx : dx;
+        int ady = (dy < 0) ? -dy : dy;
+
+        if (adx < CHASE_RANGE && ady < CHASE_RANGE && dx != 0 && batchSees[i]) {
+            batchVelocityX[i] = (dx < 0) ? -1 : 1;
         }
+        planJump[i] = (adx < JUMP_RANGE && ady < JUMP_RANGE && batchOnGround[i]) ? 1 : 0;
+    }
+}
+
+#ifdef BATCH_KERNELS_X86
+void planChaseSSE2() {
+    __m128i px = _mm_set1_epi16((short)player.x), py = _mm_set1_epi16((short)player.y);
+    __m128i chaseRange = _mm_set1_epi16(CHASE_RANGE), jumpRange = _mm_set1_epi16(JUMP_RANGE);
+    __m128i zero = _mm_setzero_si128(), one16 = _mm_set1_epi16(1), one8 = _mm_set1_epi8(1);
+
+    for (int i = 0; i < batchCapacity; i += 8) {
+        __m128i dx = _mm_sub_epi16(px, _mm_loadu_si128((const __m128i*)(batchX + i)));
+        __m128i dy = _mm_sub_epi16(py, _mm_loadu_si128((const __m128i*)(batchY + i)));
+        __m128i adx = _mm_max_epi16(dx, _mm_sub_epi16(zero, dx));
+        __m128i ady = _mm_max_epi16(dy, _mm_sub_epi16(zero, dy));
+
+        // sign(dx) where dx != 0, otherwise keep the current direction
+        __m128i right = _mm_cmpgt_epi16(dx, zero);
+        __m128i left = _mm_cmpgt_epi16(zero, dx);
+        __m128i sign = _mm_or_si128(_mm_and_si128(right, one16), left);
+        __m128i sees = _mm_loadu_si128((const __m128i*)(batchSees + i));
+        __m128i chase = _mm_and_si128(_mm_cmpgt_epi16(chaseRange, adx), _mm_cmpgt_epi16(chaseRange, ady));
+        chase = _mm_and_si128(chase, _mm_and_si128(_mm_or_si128(right, left), sees));
+
+        __m128i vx = _mm_loadu_si128((const __m128i*)(batchVelocityX + i));
+        vx = _mm_or_si128(_mm_and_si128(chase, sign), _mm_andnot_si128(chase, vx));
+        _mm_storeu_si128((__m128i*)(batchVelocityX + i), vx);
+
+        __m128i jump = _mm_and_si128(_mm_cmpgt_epi16(jumpRange, adx), _mm_cmpgt_epi16(jumpRange, ady));
+        jump = _mm_and_si128(jump, _mm_loadu_si128((const __m128i*)(batchOnGround + i)));
+        _mm_storel_epi64((__m128i*)(planJump + i), _mm_and_si128(_mm_packs_epi16(jump, jump), one8));
+    }
+}
+
+__attribute__((target("avx2")))
+void planChaseAVX2() {
+    __m256i px = _mm256_set1_epi16((short)player.x), py = _mm256_set1_epi16((short)player.y);
+    __m256i chaseRange = _mm256_set1_epi16(CHASE_RANGE), jumpRange = _mm256_set1_epi16(JUMP_RANGE);
+    __m256i zero = _mm256_setzero_si256(), one16 = _mm256_set1_epi16(1);
+    __m128i one8 = _mm_set1_epi8(1);
+
+    for (int i = 0; i < batchCapacity; i += 16) {
+        __m256i dx = _mm256_sub_epi16(px, _mm256_loadu_si256((const __m256i*)(batchX + i)));
+        __m256i dy = _mm256_sub_epi16(py, _mm256_loadu_si256((const __m256i*)(batchY + i)));
+        __m256i adx = _mm256_abs_epi16(dx);
+        __m256i ady = _mm256_abs_epi16(dy);
+
+        __m256i right = _mm256_cmpgt_epi16(dx, zero);
+        __m256i left = _mm256_cmpgt_epi16(zero, dx);
+        __m256i sign = _mm256_or_si256(_mm256_and_si256(right, one16), left);
+        __m256i sees = _mm256_loadu_si256((const __m256i*)(batchSees + i));
+        __m256i chase = _mm256_and_si256(_mm256_cmpgt_epi16(chaseRange, adx), _mm256_cmpgt_epi16(chaseRange, ady));
+        chase = _mm256_and_si256(chase, _mm256_and_si256(_mm256_or_si256(right, left), sees));
+
+        __m256i vx = _mm256_loadu_si256((const __m256i*)(batchVelocityX + i));
+        vx = _mm256_blendv_epi8(vx, sign, chase);
+        _mm256_storeu_si256((__m256i*)(batchVelocityX + i), vx);
+
+        __m256i jump = _mm256_and_si256(_mm256_cmpgt_epi16(jumpRange, adx), _mm256_cmpgt_epi16(jumpRange, ady));
+        jump = _mm256_and_si256(jump, _mm256_loadu_si256((const __m256i*)(batchOnGround + i)));
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(jump, jump), 0x08);
+        _mm_storeu_si128((__m128i*)(planJump + i), _mm_and_si128(_mm256_castsi256_si128(bytes), one8));
+    }
+}
+#endif
+
+// Plan the Walker/Jumper step for every enemy at once
+// Walker and Jumper decisions only read the player and the collision map,
+// so planning them before the AI loop gives the same result as stepping one by one
+void planGroundWalkers() {
+    gatherEnemyBatch();
+
+    // Visibility lookups - parked and padding lanes can't see
+    for (int i = 0; i < batchCapacity; i++) {
+        batchSees[i] = (i < enemyCount && hasLineOfSight(batchX[i], batchY[i])) ? -1 : 0;
+    }
+
+#ifdef BATCH_KERNELS_X86
+    if (batchKernelLevel == KERNEL_AVX2) {
+        planChaseAVX2();
+    } else if (batchKernelLevel == KERNEL_SSE2) {
+        planChaseSSE2();
+    } else {
+        planChaseScalar(0, batchCapacity);
+    }
+#else
+    planChaseScalar(0, batchCapacity);
+#endif
+
+    // Wall ahead / floor ahead - gathers from the collision map
+    for (int i = 0; i < enemyCount; i++) {
+        int vx = batchVelocityX[i];
+        int nextX = batchX[i] + vx;
+        int y = batchY[i];
 
-        if (!hasGround) enemy.isOnGround = false;
+        if (nextX < 1 || nextX >= ARENA_WIDTH - 1 || y < 0 || y >= ARENA_HEIGHT - 1) {
+            batchMask[i] = 0; // Turn around
+            continue;
+        }
+        batchMask[i] = (!solidMap[y][nextX] && solidMap[y + 1][nextX]) ? 1 : 0;
     }
 }
 
+// Apply the planned step (same effect as updateWalkerAI/updateJumperAI)
+// planJump only says a jump is allowed - the arc table picks it
+template <char Type>
+void applyGroundWalkerPlan(Enemy& enemy, int index) {
+    if constexpr (Type == 'J') {
+        if (enemy.isOnGround) {
+            enemy.isOnArc = false;
+        } else if (enemy.isOnArc) {
+            updateJumperMemory(enemy, batchSees[index] != 0);
+            stepAlongArc(enemy);
+            return;
+        }
+        bool tracksPlayer = updateJumperMemory(enemy, batchSees[index] != 0);
+        if (planJump[index] && tracksPlayer && startJumpArc(enemy)) return;
+    }
+
+    enemy.velocityX = batchVelocityX[index];
+
+    if (batchMask[index]) {
+        enemy.x += enemy.velocityX;
+    } else {
+        enemy.velocityX = -enemy.velocityX;
+    }
+}
 
 // ========================================
 // ENEMY AI - INDIVIDUAL BEHAVIORS
@@ -969,8 +3246,9 @@ void applyEnemyGravity(Enemy& enemy) {
 void updateWalkerAI(Enemy& enemy) {
     int distanceX = (player.x > enemy.x) ? (player.x - enemy.x) : (enemy.x - player.x);
     int distanceY = (player.y > enemy.y) ? (player.y - enemy.y) : (enemy.y - player.y);
+    bool seesPlayer = hasLineOfSight(enemy.x, enemy.y);
 
-    if (distanceX < CHASE_RANGE && distanceY < CHASE_RANGE) {
+    if (distanceX < CHASE_RANGE && distanceY < CHASE_RANGE && seesPlayer) {
         if (player.x < enemy.x) {
             enemy.velocityX = -1;
         } else if (player.x > enemy.x) {
@@ -992,15 +3270,26 @@ void updateWalkerAI(Enemy& enemy) {
 }
 
 void updateJumperAI(Enemy& enemy) {
+    bool seesPlayer = hasLineOfSight(enemy.x, enemy.y);
+
+    // Follow the arc until it lands
+    if (enemy.isOnGround) {
+        enemy.isOnArc = false;
+    } else if (enemy.isOnArc) {
+        updateJumperMemory(enemy, seesPlayer);
+        stepAlongArc(enemy);
+        return;
+    }
+
     int distanceX = (player.x > enemy.x) ? (player.x - enemy.x) : (enemy.x - player.x);
     int distanceY = (player.y > enemy.y) ? (player.y - enemy.y) : (enemy.y - player.y);
+    bool tracksPlayer = updateJumperMemory(enemy, seesPlayer);
 
-    if (distanceX < JUMP_RANGE && distanceY < JUMP_RANGE && enemy.isOnGround) {
-        enemy.velocityY = PLAYER_JUMP_VELOCITY;
-        enemy.isOnGround = false;
+    if (distanceX < JUMP_RANGE && distanceY < JUMP_RANGE && enemy.isOnGround && tracksPlayer) {
+        if (startJumpArc(enemy)) return;
     }
 
-    if (distanceX < CHASE_RANGE && distanceY < CHASE_RANGE) {
+    if (distanceX < CHASE_RANGE && distanceY < CHASE_RANGE && seesPlayer) {
         if (player.x < enemy.x) {
             enemy.velocityX = -1;
         } else if (player.x > enemy.x) {
@@ -1062,9 +3351,10 @@ void updateFlierAI(Enemy& enemy) {
         enemy.x = nextX;
     }
 
-    enemy.aiTimer++;
-    if (enemy.aiTimer >= FLIER_DESCENT_INTERVAL) {
-        if (enemy.y < player.y) {
+    // Only homes in on a player it can see, otherwise waits for the next interval
+    if (enemy.descentDue) {
+        bool seesPlayer = hasLineOfSight(enemy.x, enemy.y);
+        if (seesPlayer && enemy.y < player.y) {
             for (int dy = 1; dy <= FLIER_DESCENT_AMOUNT; dy++) {
                 if (!isColliding(enemy.x, enemy.y + dy)) {
                     enemy.y++;
@@ -1072,7 +3362,7 @@ void updateFlierAI(Enemy& enemy) {
                     break;
                 }
             }
-        } else if (enemy.y > player.y) {
+        } else if (seesPlayer && enemy.y > player.y) {
             for (int dy = 1; dy <= FLIER_DESCENT_AMOUNT; dy++) {
                 if (!isColliding(enemy.x, enemy.y - dy)) {
                     enemy.y--;
@@ -1081,439 +3371,961 @@ void updateFlierAI(Enemy& enemy) {
                 }
             }
         }
-        enemy.aiTimer = 0;
+        enemy.descentDue = false;
+        scheduleTimer(enemy.id, TIMER_FLIER_DESCENT, FLIER_DESCENT_INTERVAL);
     }
 }
 
-void updateEnemyAI() {
-    for (int i = 0; i < enemyCount; i++) {
-        if (!enemies[i].isActive) continue;
-
-        Enemy& enemy = enemies[i];
-
-        if (enemy.type == 'E') {
-            updateWalkerAI(enemy);
-        } else if (enemy.type == 'J') {
-            updateJumperAI(enemy);
-        } else if (enemy.type == 'F') {
-            updateFlierAI(enemy);
-        } else if (enemy.type == 'C') {
-            // Crawler: Sticks to surfaces (floor, walls, ceiling) following complete surface logic
-
-            // Handle edge wrapping multi-step movement
-            if (enemy.edgeWrapStep > 0) {
-                // Steps 1-4: Floor to Ceiling wrapping
-                if (enemy.edgeWrapStep >= 1 && enemy.edgeWrapStep <= 4) {
-                    int originalDir = (enemy.edgeWrapStep == 1 || enemy.edgeWrapStep == 4) ? 1 : -1;
-                    if (enemy.velocityX == 0) {
-                        // Determine direction from wrap step
-                        originalDir = (enemy.edgeWrapStep == 1 || enemy.edgeWrapStep == 4) ? -1 : 1;
-                    }
-
-                    if (enemy.edgeWrapStep == 1) {
-                        // Step 1: Move one space in original direction
-                        enemy.x += (enemy.velocityX != 0) ? enemy.velocityX : originalDir;
-                        enemy.edgeWrapStep = 2;
-                    } else if (enemy.edgeWrapStep == 2) {
-                        // Step 2: Move one space down
-                        enemy.y++;
-                        enemy.edgeWrapStep = 3;
-                    } else if (enemy.edgeWrapStep == 3) {
-                        // Step 3: Move one more space down
-                        enemy.y++;
-                        enemy.edgeWrapStep = 4;
-                    } else if (enemy.edgeWrapStep == 4) {
-                        // Step 4: Move one space back and switch to ceiling mode
-                        int wrapDir = (enemy.velocityX != 0) ? -enemy.velocityX : -originalDir;
-                        enemy.x += wrapDir;
-                        enemy.surface = 'c';
-                        enemy.velocityX = wrapDir;
-                        enemy.edgeWrapStep = 0; // Done wrapping
-                    }
-                }
-                // Steps 5-8: Ceiling to Floor wrapping (reverse of floor to ceiling)
-                else if (enemy.edgeWrapStep >= 5 && enemy.edgeWrapStep <= 8) {
-                    int originalDir = (enemy.edgeWrapStep == 5 || enemy.edgeWrapStep == 8) ? 1 : -1;
-                    if (enemy.velocityX == 0) {
-                        // Determine direction from wrap step
-                        originalDir = (enemy.edgeWrapStep == 5 || enemy.edgeWrapStep == 8) ? -1 : 1;
-                    }
-
-                    if (enemy.edgeWrapStep == 5) {
-                        // Step 5: Move one space in original direction
-                        enemy.x += (enemy.velocityX != 0) ? enemy.velocityX : originalDir;
-                        enemy.edgeWrapStep = 6;
-                    } else if (enemy.edgeWrapStep == 6) {
-                        // Step 6: Move one space UP
-                        enemy.y--;
-                        enemy.edgeWrapStep = 7;
-                    } else if (enemy.edgeWrapStep == 7) {
-                        // Step 7: Move one more space UP
-                        enemy.y--;
-                        enemy.edgeWrapStep = 8;
-                    } else if (enemy.edgeWrapStep == 8) {
-                        // Step 8: Move one space back and switch to floor mode
-                        int wrapDir = (enemy.velocityX != 0) ? -enemy.velocityX : -originalDir;
-                        enemy.x += wrapDir;
-                        enemy.surface = 'f';
-                        enemy.velocityX = wrapDir;
-                        enemy.edgeWrapStep = 0; // Done wrapping
-                    }
-                }
-                continue; // Skip normal movement this frame
-            }
-
-            if (enemy.surface == 'f') {
-                // ===== FLOOR MODE =====
-                // Current state: surface below at (x, y+1)
-                // Movement: horizontal (velocityX = ±1)
-
-                int nextX = enemy.x + enemy.velocityX;
-
-                // Case 1A: Wall blocking ahead (includes boundary walls)
-                if (nextX <= 0 || nextX >= ARENA_WIDTH - 1 || isColliding(nextX, enemy.y)) {
-                    // Hit a wall - transition to climbing it
-                    if (enemy.velocityX > 0) {
-                        enemy.surface = 'r';
-                        enemy.velocityY = -1; // Climb up
-                        enemy.velocityX = 0;
-                    } else {
-                        enemy.surface = 'l';
-                        enemy.velocityY = -1; // Climb up
-                        enemy.velocityX = 0;
-                    }
-                }
-                // Case 1B: Floor continues
-                else if (isColliding(nextX, enemy.y + 1)) {
-                    // Floor exists below, move forward
-                    enemy.x = nextX;
-                }
-                // Case 1C: Platform edge - move around the edge to get underneath
-                else {
-                    // Check if there's a wall ahead that we should climb instead
-                    if (enemy.velocityX > 0 && isColliding(nextX + 1, enemy.y)) {
-                        // Wall to the right of the edge, climb it
-                        enemy.surface = 'r';
-                        enemy.velocityY = -1;
-                        enemy.velocityX = 0;
-                    } else if (enemy.velocityX < 0 && isColliding(nextX - 1, enemy.y)) {
-                        // Wall to the left of the edge, climb it
-                        enemy.surface = 'l';
-                        enemy.velocityY = -1;
-                        enemy.velocityX = 0;
-                    } else {
-                        // No wall, start edge wrapping sequence
-                        // Example: crawler at (20,10), platform at (20,9)
-                        // Moving right: (20,10) -> (21,10) -> (21,11) -> (21,12) -> (20,12)
-                        // This will happen over 4 frames
-                        enemy.edgeWrapStep = 1;
-                    }
-                }
-            }
-            else if (enemy.surface == 'r') {
-                // ===== RIGHT WALL MODE =====
-                // Current state: surface right at (x+1, y)
-                // Movement: vertical (velocityY = ±1)
-
-                int nextY = enemy.y + enemy.velocityY;
-
-                // Check for transitions FIRST before boundaries
-                // Check if wall still exists to the right at next position
-                bool wallContinues = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x + 1, nextY));
-                bool pathBlocked = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x, nextY));
-
-                // Case 2A: Path blocked by obstacle
-                if (pathBlocked) {
-                    enemy.velocityY = -enemy.velocityY; // Turn around
-                }
-                // Case 2B: Wall continues
-                else if (wallContinues) {
-                    // Wall exists, move along it
-                    enemy.y = nextY;
-                }
-                // Wall ends OR boundary reached - check for transitions
-                else {
-                    // Case 2C: Going up - check for ceiling
-                    if (enemy.velocityY < 0) {
-                        if (isColliding(enemy.x, enemy.y - 1)) {
-                            // Ceiling exists, transition to it
-                            enemy.surface = 'c';
-                            enemy.velocityX = -1; // Move left (away from wall)
-                            enemy.velocityY = 0;
-                        } else {
-                            enemy.velocityY = -enemy.velocityY; // Turn around
-                        }
-                    }
-                    // Case 2D: Going down - check for floor
-                    else {
-                        if (isColliding(enemy.x, enemy.y + 1)) {
-                            // Floor exists, transition to it
-                            enemy.surface = 'f';
-                            enemy.velocityX = -1; // Move left (away from wall)
-                            enemy.velocityY = 0;
-                        } else {
-                            enemy.velocityY = -enemy.velocityY; // Turn around
-                        }
-                    }
-                }
-            }
-            else if (enemy.surface == 'l') {
-                // ===== LEFT WALL MODE =====
-                // Current state: surface left at (x-1, y)
-                // Movement: vertical (velocityY = ±1)
-
-                int nextY = enemy.y + enemy.velocityY;
-
-                // Check for transitions FIRST before boundaries
-                // Check if wall still exists to the left at next position
-                bool wallContinues = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x - 1, nextY));
-                bool pathBlocked = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x, nextY));
-
-                // Case 3A: Path blocked by obstacle
-                if (pathBlocked) {
-                    enemy.velocityY = -enemy.velocityY; // Turn around
-                }
-                // Case 3B: Wall continues
-                else if (wallContinues) {
-                    // Wall exists, move along it
-                    enemy.y = nextY;
-                }
-                // Wall ends OR boundary reached - check for transitions
-                else {
-                    // Case 3C: Going up - check for ceiling
-                    if (enemy.velocityY < 0) {
-                        if (isColliding(enemy.x, enemy.y - 1)) {
-                            // Ceiling exists, transition to it
-                            enemy.surface = 'c';
-                            enemy.velocityX = 1; // Move right (away from wall)
-                            enemy.velocityY = 0;
-                        } else {
-                            enemy.velocityY = -enemy.velocityY; // Turn around
-                        }
-                    }
-                    // Case 3D: Going down - check for floor
-                    else {
-                        if (isColliding(enemy.x, enemy.y + 1)) {
-                            // Floor exists, transition to it
-                            enemy.surface = 'f';
-                            enemy.velocityX = 1; // Move right (away from wall)
-                            enemy.velocityY = 0;
-                        } else {
-                            enemy.velocityY = -enemy.velocityY; // Turn around
-                        }
-                    }
-                }
-            }
-            else if (enemy.surface == 'c') {
-                // ===== CEILING MODE =====
-                // Current state: surface above at (x, y-1)
-                // Movement: horizontal (velocityX = ±1)
-
-                int nextX = enemy.x + enemy.velocityX;
-
-                // Case 4A: Wall blocking ahead (includes boundary walls)
-                if (nextX <= 0 || nextX >= ARENA_WIDTH - 1 || isColliding(nextX, enemy.y)) {
-                    // Hit a wall - transition to climbing down
-                    if (enemy.velocityX > 0) {
-                        enemy.surface = 'r';
-                        enemy.velocityY = 1; // Descend
-                        enemy.velocityX = 0;
-                    } else {
-                        enemy.surface = 'l';
-                        enemy.velocityY = 1; // Descend
-                        enemy.velocityX = 0;
-                    }
-                }
-                // Case 4B: Ceiling continues
-                else if (isColliding(nextX, enemy.y - 1)) {
-                    // Ceiling exists above, move forward
-                    enemy.x = nextX;
-                }
-                // Case 4C: Ceiling edge - move around the edge to get on top
-                else {
-                    // Check if there's a wall ahead that we should climb instead
-                    if (enemy.velocityX > 0 && isColliding(nextX + 1, enemy.y)) {
-                        // Wall to the right of the edge, climb it
-                        enemy.surface = 'r';
-                        enemy.velocityY = 1; // Descend down the wall
-                        enemy.velocityX = 0;
-                    } else if (enemy.velocityX < 0 && isColliding(nextX - 1, enemy.y)) {
-                        // Wall to the left of the edge, climb it
-                        enemy.surface = 'l';
-                        enemy.velocityY = 1; // Descend down the wall
-                        enemy.velocityX = 0;
-                    } else {
-                        // No wall, start edge wrapping sequence (ceiling to floor)
-                        // Example: crawler at (20,12), ceiling at (20,11)
-                        // Moving right: (20,12) -> (21,12) -> (21,11) -> (21,10) -> (20,10)
-                        // This will happen over 4 frames (using steps 5-8)
-                        enemy.edgeWrapStep = 5; // Use 5-8 for ceiling wrapping
-                    }
-                }
-            }
-        } else if (enemy.type == 'B') {
-            // Boss: AOE attack system
-            // State 0: Walking normally
-            // State 1: Winding up (5 seconds)
-            // State 2: Attack triggered (1 frame)
-
-            if (enemy.attackState == 0) {
-                // Walking state - normal movement
-                enemy.aiTimer++;
-                const int ATTACK_INTERVAL = 30;
-
-                if (enemy.aiTimer >= ATTACK_INTERVAL) {
-                    // Start windup
-                    enemy.attackState = 1;
-                    enemy.windupTimer = 10;
-                    enemy.aiTimer = 0;
-                } else {
-                    // Normal walking behavior
-                    int nextX = enemy.x + enemy.velocityX;
-
-                    // Check if next position is valid (Boss is 3x3, so check all tiles)
-                    bool canMove = true;
-                    if (nextX - 1 < 1 || nextX + 1 >= ARENA_WIDTH - 1) {
-                        canMove = false; // Hit boundary
-                    } else {
-                        // Check if any part of Boss would collide
-                        for (int dy = -1; dy <= 1; dy++) {
-                            if (isColliding(nextX - 1, enemy.y + dy) ||
-                                isColliding(nextX, enemy.y + dy) ||
-                                isColliding(nextX + 1, enemy.y + dy)) {
-                                canMove = false;
-                                break;
-                            }
-                        }
-                    }
-
-                    if (!canMove) {
-                        // Hit wall, turn around
-                        enemy.velocityX = -enemy.velocityX;
-                    } else {
-                        // Check if there's ground ahead for all bottom tiles
-                        bool hasGround = false;
-                        for (int dx = -1; dx <= 1; dx++) {
-                            if (isColliding(nextX + dx, enemy.y + 2)) {
-                                hasGround = true;
-                                break;
-                            }
-                        }
-
-                        if (!hasGround) {
-                            // No ground ahead, turn around
-                            enemy.velocityX = -enemy.velocityX;
-                        } else {
-                            // Safe to move
-                            enemy.x = nextX;
-                        }
-                    }
-                }
-            } else if (enemy.attackState == 1) {
-                // Winding up - Boss stops moving, countdown timer
-                enemy.windupTimer--;
-                if (enemy.windupTimer <= 0) {
-                    // Trigger attack
-                    enemy.attackState = 2;
-                }
-            } else if (enemy.attackState == 2) {
-                // Attack frame - deal damage in 11x11 area
-                // Check if player is in AOE range (5 tiles from Boss center)
-                int distX = (player.x > enemy.x) ? (player.x - enemy.x) : (enemy.x - player.x);
-                int distY = (player.y > enemy.y) ? (player.y - enemy.y) : (enemy.y - player.y);
-
-                if (distX <= 5 && distY <= 5) {
-                    // Player is in AOE, deal 3 damage
-                    player.hp -= 3;
-                }
-
-                // Return to walking state
-                enemy.attackState = 0;
-                enemy.aiTimer = 0; // Reset 10-second timer
-            }
-        }
+// Crawler: Sticks to surfaces (floor, walls, ceiling) following complete surface logic
+void updateCrawlerAI(Enemy& enemy) {
+    // Edge wrapping is a multi-step movement that replaces normal movement
+    if (enemy.edgeWrapStep > 0) {
+        handleCrawlerEdgeWrap(enemy);
+    } else if (enemy.surface == 'f') {
+        handleCrawlerFloorMode(enemy);
+    } else if (enemy.surface == 'r') {
+        handleCrawlerRightWallMode(enemy);
+    } else if (enemy.surface == 'l') {
+        handleCrawlerLeftWallMode(enemy);
+    } else if (enemy.surface == 'c') {
+        handleCrawlerCeilingMode(enemy);
     }
 }
 
-void updateEnemies() {
-    for (int i = 0; i < enemyCount; i++) {
-        if (!enemies[i].isActive) continue;
+void handleCrawlerEdgeWrap(Enemy& enemy) {
+    // Steps 1-4: Floor to Ceiling wrapping
+    if (enemy.edgeWrapStep >= 1 && enemy.edgeWrapStep <= 4) {
+        int originalDir = (enemy.edgeWrapStep == 1 || enemy.edgeWrapStep == 4) ? 1 : -1;
+        if (enemy.velocityX == 0) {
+            // Determine direction from wrap step
+            originalDir = (enemy.edgeWrapStep == 1 || enemy.edgeWrapStep == 4) ? -1 : 1;
+        }
 
-        // Fliers and Crawlers don't obey gravity
-        if (enemies[i].type != 'F' && enemies[i].type != 'C') {
-            applyEnemyGravity(enemies[i]);
+        if (enemy.edgeWrapStep == 1) {
+            // Step 1: Move one space in original direction
+            enemy.x += (enemy.velocityX != 0) ? enemy.velocityX : originalDir;
+            enemy.edgeWrapStep = 2;
+        } else if (enemy.edgeWrapStep == 2) {
+            // Step 2: Move one space down
+            enemy.y++;
+            enemy.edgeWrapStep = 3;
+        } else if (enemy.edgeWrapStep == 3) {
+            // Step 3: Move one more space down
+            enemy.y++;
+            enemy.edgeWrapStep = 4;
+        } else if (enemy.edgeWrapStep == 4) {
+            // Step 4: Move one space back and switch to ceiling mode
+            int wrapDir = (enemy.velocityX != 0) ? -enemy.velocityX : -originalDir;
+            enemy.x += wrapDir;
+            enemy.surface = 'c';
+            enemy.velocityX = wrapDir;
+            enemy.edgeWrapStep = 0; // Done wrapping
         }
     }
+    // Steps 5-8: Ceiling to Floor wrapping (reverse of floor to ceiling)
+    else if (enemy.edgeWrapStep >= 5 && enemy.edgeWrapStep <= 8) {
+        int originalDir = (enemy.edgeWrapStep == 5 || enemy.edgeWrapStep == 8) ? 1 : -1;
+        if (enemy.velocityX == 0) {
+            // Determine direction from wrap step
+            originalDir = (enemy.edgeWrapStep == 5 || enemy.edgeWrapStep == 8) ? -1 : 1;
+        }
 
-    updateEnemyAI();
+        if (enemy.edgeWrapStep == 5) {
+            // Step 5: Move one space in original direction
+            enemy.x += (enemy.velocityX != 0) ? enemy.velocityX : originalDir;
+            enemy.edgeWrapStep = 6;
+        } else if (enemy.edgeWrapStep == 6) {
+            // Step 6: Move one space UP
+            enemy.y--;
+            enemy.edgeWrapStep = 7;
+        } else if (enemy.edgeWrapStep == 7) {
+            // Step 7: Move one more space UP
+            enemy.y--;
+            enemy.edgeWrapStep = 8;
+        } else if (enemy.edgeWrapStep == 8) {
+            // Step 8: Move one space back and switch to floor mode
+            int wrapDir = (enemy.velocityX != 0) ? -enemy.velocityX : -originalDir;
+            enemy.x += wrapDir;
+            enemy.surface = 'f';
+            enemy.velocityX = wrapDir;
+            enemy.edgeWrapStep = 0; // Done wrapping
+        }
+    }
 }
 
-// Check if active attack hits any enemies and apply damage
-void checkAttackHits() {
-    if (!currentAttack.isActive) return;
+void handleCrawlerFloorMode(Enemy& enemy) {
+    // ===== FLOOR MODE =====
+    // Current state: surface below at (x, y+1)
+    // Movement: horizontal (velocityX = ±1)
 
-    for (int i = 0; i < enemyCount; i++) {
-        if (!enemies[i].isActive) continue;
+    int nextX = enemy.x + enemy.velocityX;
 
-        if (isEnemyHitByAttack(enemies[i])) {
-            enemies[i].hp--;
-            if (enemies[i].hp <= 0) {
-                enemies[i].isActive = false;
-            }
-            currentAttack.isActive = false;
-            break;
+    // Case 1A: Wall blocking ahead (includes boundary walls)
+    if (nextX <= 0 || nextX >= ARENA_WIDTH - 1 || isColliding(nextX, enemy.y)) {
+        // Hit a wall - transition to climbing it
+        if (enemy.velocityX > 0) {
+            enemy.surface = 'r';
+            enemy.velocityY = -1; // Climb up
+            enemy.velocityX = 0;
+        } else {
+            enemy.surface = 'l';
+            enemy.velocityY = -1; // Climb up
+            enemy.velocityX = 0;
         }
     }
-
-    // Clean up defeated enemies
-    for (int i = enemyCount - 1; i >= 0; i--) {
-        if (!enemies[i].isActive) {
-            removeEnemy(i);
+    // Case 1B: Floor continues
+    else if (isColliding(nextX, enemy.y + 1)) {
+        // Floor exists below, move forward
+        enemy.x = nextX;
+    }
+    // Case 1C: Platform edge - move around the edge to get underneath
+    else {
+        // Check if there's a wall ahead that we should climb instead
+        if (enemy.velocityX > 0 && isColliding(nextX + 1, enemy.y)) {
+            // Wall to the right of the edge, climb it
+            enemy.surface = 'r';
+            enemy.velocityY = -1;
+            enemy.velocityX = 0;
+        } else if (enemy.velocityX < 0 && isColliding(nextX - 1, enemy.y)) {
+            // Wall to the left of the edge, climb it
+            enemy.surface = 'l';
+            enemy.velocityY = -1;
+            enemy.velocityX = 0;
+        } else {
+            // No wall, start edge wrapping sequence
+            // Example: crawler at (20,10), platform at (20,9)
+            // Moving right: (20,10) -> (21,10) -> (21,11) -> (21,12) -> (20,12)
+            // This will happen over 4 frames
+            enemy.edgeWrapStep = 1;
         }
     }
 }
 
+void handleCrawlerRightWallMode(Enemy& enemy) {
+    // ===== RIGHT WALL MODE =====
+    // Current state: surface right at (x+1, y)
+    // Movement: vertical (velocityY = ±1)
 
-// Check for player-enemy collisions and apply damage
-void checkPlayerEnemyCollision() {
-    for (int i = 0; i < enemyCount; i++) {
-        if (!enemies[i].isActive) continue;
+    int nextY = enemy.y + enemy.velocityY;
 
-        bool collision = false;
+    // Check for transitions FIRST before boundaries
+    // Check if wall still exists to the right at next position
+    bool wallContinues = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x + 1, nextY));
+    bool pathBlocked = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x, nextY));
 
-        // Boss has 3x3 hitbox
-        if (enemies[i].type == 'B') {
-            if (player.x >= enemies[i].x - 1 && player.x <= enemies[i].x + 1 &&
-                player.y >= enemies[i].y - 1 && player.y <= enemies[i].y + 1) {
-                collision = true;
+    // Case 2A: Path blocked by obstacle
+    if (pathBlocked) {
+        enemy.velocityY = -enemy.velocityY; // Turn around
+    }
+    // Case 2B: Wall continues
+    else if (wallContinues) {
+        // Wall exists, move along it
+        enemy.y = nextY;
+    }
+    // Wall ends OR boundary reached - check for transitions
+    else {
+        // Case 2C: Going up - check for ceiling
+        if (enemy.velocityY < 0) {
+            if (isColliding(enemy.x, enemy.y - 1)) {
+                // Ceiling exists, transition to it
+                enemy.surface = 'c';
+                enemy.velocityX = -1; // Move left (away from wall)
+                enemy.velocityY = 0;
+            } else {
+                enemy.velocityY = -enemy.velocityY; // Turn around
             }
         }
-        // Normal enemies have 1x1 hitbox
+        // Case 2D: Going down - check for floor
         else {
-            if (enemies[i].x == player.x && enemies[i].y == player.y) {
-                collision = true;
-            }
-        }
-
-        if (collision) {
-            player.hp--;
-
-            // Regular enemies die on contact, Boss doesn't
-            if (enemies[i].type != 'B') {
-                enemies[i].isActive = false;
-                removeEnemy(i);
-                i--;
+            if (isColliding(enemy.x, enemy.y + 1)) {
+                // Floor exists, transition to it
+                enemy.surface = 'f';
+                enemy.velocityX = -1; // Move left (away from wall)
+                enemy.velocityY = 0;
+            } else {
+                enemy.velocityY = -enemy.velocityY; // Turn around
             }
         }
     }
 }
 
-// Free dynamically allocated enemy array
-void cleanupEnemies() {
-    if (enemies != nullptr) {
-        delete[] enemies;
-        enemies = nullptr;
+void handleCrawlerLeftWallMode(Enemy& enemy) {
+    // ===== LEFT WALL MODE =====
+    // Current state: surface left at (x-1, y)
+    // Movement: vertical (velocityY = ±1)
+
+    int nextY = enemy.y + enemy.velocityY;
+
+    // Check for transitions FIRST before boundaries
+    // Check if wall still exists to the left at next position
+    bool wallContinues = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x - 1, nextY));
+    bool pathBlocked = (nextY > 0 && nextY < ARENA_HEIGHT - 1 && isColliding(enemy.x, nextY));
+
+    // Case 3A: Path blocked by obstacle
+    if (pathBlocked) {
+        enemy.velocityY = -enemy.velocityY; // Turn around
     }
+    // Case 3B: Wall continues
+    else if (wallContinues) {
+        // Wall exists, move along it
+        enemy.y = nextY;
+    }
+    // Wall ends OR boundary reached - check for transitions
+    else {
+        // Case 3C: Going up - check for ceiling
+        if (enemy.velocityY < 0) {
+            if (isColliding(enemy.x, enemy.y - 1)) {
+                // Ceiling exists, transition to it
+                enemy.surface = 'c';
+                enemy.velocityX = 1; // Move right (away from wall)
+                enemy.velocityY = 0;
+            } else {
+                enemy.velocityY = -enemy.velocityY; // Turn around
+            }
+        }
+        // Case 3D: Going down - check for floor
+        else {
+            if (isColliding(enemy.x, enemy.y + 1)) {
+                // Floor exists, transition to it
+                enemy.surface = 'f';
+                enemy.velocityX = 1; // Move right (away from wall)
+                enemy.velocityY = 0;
+            } else {
+                enemy.velocityY = -enemy.velocityY; // Turn around
+            }
+        }
+    }
+}
+
+void handleCrawlerCeilingMode(Enemy& enemy) {
+    // ===== CEILING MODE =====
+    // Current state: surface above at (x, y-1)
+    // Movement: horizontal (velocityX = ±1)
+
+    int nextX = enemy.x + enemy.velocityX;
+
+    // Case 4A: Wall blocking ahead (includes boundary walls)
+    if (nextX <= 0 || nextX >= ARENA_WIDTH - 1 || isColliding(nextX, enemy.y)) {
+        // Hit a wall - transition to climbing down
+        if (enemy.velocityX > 0) {
+            enemy.surface = 'r';
+            enemy.velocityY = 1; // Descend
+            enemy.velocityX = 0;
+        } else {
+            enemy.surface = 'l';
+            enemy.velocityY = 1; // Descend
+            enemy.velocityX = 0;
+        }
+    }
+    // Case 4B: Ceiling continues
+    else if (isColliding(nextX, enemy.y - 1)) {
+        // Ceiling exists above, move forward
+        enemy.x = nextX;
+    }
+    // Case 4C: Ceiling edge - move around the edge to get on top
+    else {
+        // Check if there's a wall ahead that we should climb instead
+        if (enemy.velocityX > 0 && isColliding(nextX + 1, enemy.y)) {
+            // Wall to the right of the edge, climb it
+            enemy.surface = 'r';
+            enemy.velocityY = 1; // Descend down the wall
+            enemy.velocityX = 0;
+        } else if (enemy.velocityX < 0 && isColliding(nextX - 1, enemy.y)) {
+            // Wall to the left of the edge, climb it
+            enemy.surface = 'l';
+            enemy.velocityY = 1; // Descend down the wall
+            enemy.velocityX = 0;
+        } else {
+            // No wall, start edge wrapping sequence (ceiling to floor)
+            // Example: crawler at (20,12), ceiling at (20,11)
+            // Moving right: (20,12) -> (21,12) -> (21,11) -> (21,10) -> (20,10)
+            // This will happen over 4 frames (using steps 5-8)
+            enemy.edgeWrapStep = 5; // Use 5-8 for ceiling wrapping
+        }
+    }
+}
+
+void updateBossAI(Enemy& enemy) {
+    // Boss: AOE attack system, state changes come from the timer wheel
+    // State 0: Walking normally
+    // State 1: Winding up (asleep until the trigger timer)
+    // State 2: Attack triggered (blast fires on the next tick)
+
+    if (enemy.attackState == 0) {
+        // Walking state - normal movement
+        int nextX = enemy.x + enemy.velocityX;
+        constexpr int halfWidth = traitsOf('B').halfWidth;
+        constexpr int halfHeight = traitsOf('B').halfHeight;
+
+        // Whole footprint must fit at the next position
+        bool canMove = nextX - halfWidth >= 1 && nextX + halfWidth < ARENA_WIDTH - 1 &&
+                       isRectFree(nextX - halfWidth, enemy.y - halfHeight,
+                                  nextX + halfWidth, enemy.y + halfHeight);
+
+        if (!canMove) {
+            // Hit wall, turn around
+            enemy.velocityX = -enemy.velocityX;
+        } else {
+            // Check if there's ground ahead under the bottom row
+            if (!hasGroundUnder(nextX - halfWidth, nextX + halfWidth, enemy.y + halfHeight + 1)) {
+                // No ground ahead, turn around
+                enemy.velocityX = -enemy.velocityX;
+            } else {
+                // Safe to move
+                enemy.x = nextX;
+            }
+        }
+    }
+}
+
+// AI step for one enemy kind - the walker/jumper batch plan and the per-kind
+// behavior are picked at compile time
+template <char Type>
+void updateEnemyKindAI(Enemy& enemy, int index, bool useBatch) {
+    if constexpr (Type == 'E' || Type == 'J') {
+        if (useBatch) {
+            applyGroundWalkerPlan<Type>(enemy, index);
+            return;
+        }
+    }
+
+    if constexpr (Type == 'E') {
+        updateWalkerAI(enemy);
+    } else if constexpr (Type == 'J') {
+        updateJumperAI(enemy);
+    } else if constexpr (Type == 'F') {
+        updateFlierAI(enemy);
+    } else if constexpr (Type == 'C') {
+        updateCrawlerAI(enemy);
+    } else if constexpr (Type == 'B') {
+        updateBossAI(enemy);
+    }
+}
+
+void updateEnemyAI() {
+    updateVisibility();
+    playerStandY = findStandingRow(player.x, player.y);
+    advanceTimerWheel();
+
+    bool useBatch = batchKernelLevel != KERNEL_SCALAR;
+    if (useBatch) {
+        planGroundWalkers();
+    }
+
+    for (int i = 0; i < enemyCount; i++) {
+        if (!enemies[i].isActive || !isEnemyScheduled(i)) continue;
+
+        Enemy& enemy = enemies[i];
+
+        switch (enemy.type) {
+            case 'E': updateEnemyKindAI<'E'>(enemy, i, useBatch); break;
+            case 'J': updateEnemyKindAI<'J'>(enemy, i, useBatch); break;
+            case 'F': updateEnemyKindAI<'F'>(enemy, i, useBatch); break;
+            case 'C': updateEnemyKindAI<'C'>(enemy, i, useBatch); break;
+            case 'B': updateEnemyKindAI<'B'>(enemy, i, useBatch); break;
+        }
+    }
+}
+
+void updateEnemies() {
+    scheduleEnemyUpdates();
+
+    // Sweeps only cover this tick's movement
+    for (int i = 0; i < enemyCount; i++) {
+        enemies[i].sweepTop = 0;
+        enemies[i].sweepBottom = -1;
+    }
+
+    for (int i = 0; i < enemyCount; i++) {
+        if (!enemies[i].isActive || !isEnemyScheduled(i)) continue;
+
+        switch (enemies[i].type) {
+            case 'E': updateEnemyPhysics<'E'>(enemies[i]); break;
+            case 'J': updateEnemyPhysics<'J'>(enemies[i]); break;
+            case 'F': updateEnemyPhysics<'F'>(enemies[i]); break;
+            case 'C': updateEnemyPhysics<'C'>(enemies[i]); break;
+            case 'B': updateEnemyPhysics<'B'>(enemies[i]); break;
+        }
+    }
+
+    updateEnemyAI();
+}
+
+// ========================================
+// UPDATE LEVEL OF DETAIL
+// ========================================
+
+// Sort enemies into distance tiers and decide who updates this tick.
+// Near enemies keep the exact behavior. Mid and far tiers advance every
+// 2nd / 4th tick (staggered by id so the work is spread evenly and an
+// enemy keeps its phase when removals shift the array), and
+// sleeping enemies wait until the player comes within LOD_SLEEP_RANGE.
+// A far enemy moves at most one cell per update like everyone else -
+// longer steps would skip the per-cell collision checks.
+void scheduleEnemyUpdates() {
+    if (!lodEnabled) return;
+
+    if (enemyCount > lodCapacity) {
+        delete[] lodScheduled;
+        lodCapacity = enemyCapacity;
+        lodScheduled = new unsigned char[lodCapacity];
+    }
+
+    for (int t = 0; t < 4; t++) {
+        lodTierCounts[t] = 0;
+    }
+
+    for (int i = 0; i < enemyCount; i++) {
+        int distX = (player.x > enemies[i].x) ? (player.x - enemies[i].x) : (enemies[i].x - player.x);
+        int distY = (player.y > enemies[i].y) ? (player.y - enemies[i].y) : (enemies[i].y - player.y);
+        int distance = (distX > distY) ? distX : distY;
+
+        int tier;
+        int interval;
+        if (distance < LOD_NEAR_RANGE) {
+            tier = 0;
+            interval = 1;
+        } else if (distance < LOD_MID_RANGE) {
+            tier = 1;
+            interval = LOD_MID_INTERVAL;
+        } else if (distance < LOD_SLEEP_RANGE) {
+            tier = 2;
+            interval = LOD_FAR_INTERVAL;
+        } else {
+            tier = 3;
+            interval = 0;
+        }
+
+        lodTierCounts[tier]++;
+        lodScheduled[i] = (interval > 0 && (currentTick + (unsigned int)enemies[i].id) % interval == 0) ? 1 : 0;
+
+        // Timers that came due while it was skipped fire on this update
+        if (lodScheduled[i] && enemies[i].parkedTimers >= 0) {
+            rearmParkedTimers(enemies[i]);
+        }
+    }
+}
+
+bool isEnemyScheduled(int index) {
+    return !lodEnabled || lodScheduled[index];
+}
+
+// ========================================
+// TIMER WHEEL
+// ========================================
+
+// Wake enemy `enemyId` after `delay` ticks (counted from the current tick)
+void scheduleTimer(int enemyId, int kind, int delay) {
+    if (!timerWheelReady) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) timerWheel[i] = -1;
+        for (int i = 0; i < TIMER_WHEEL_OUTER_SLOTS; i++) timerWheelOuter[i] = -1;
+        timerWheelTick = currentTick;
+        timerWheelReady = true;
+    }
+
+    int node = allocateTimerNode();
+    timerNodes[node].enemyId = enemyId;
+    timerNodes[node].kind = kind;
+    timerNodes[node].due = currentTick + (unsigned int)(delay > 0 ? delay : 0);
+    if (timerNodes[node].due < timerWheelTick) {
+        timerNodes[node].due = timerWheelTick; // Already processed this tick, fire on the next one
+    }
+    insertTimerNode(node);
+}
+
+// Take a node off the free list - grows the pool (moving timerNodes) when empty
+int allocateTimerNode() {
+    if (timerFreeList < 0) {
+        int newCapacity = (timerNodeCapacity == 0) ? 64 : timerNodeCapacity * 2;
+        TimerNode* newNodes = new TimerNode[newCapacity];
+        for (int i = 0; i < timerNodeCapacity; i++) {
+            newNodes[i] = timerNodes[i];
+        }
+        for (int i = newCapacity - 1; i >= timerNodeCapacity; i--) {
+            newNodes[i].next = timerFreeList;
+            timerFreeList = i;
+        }
+        delete[] timerNodes;
+        timerNodes = newNodes;
+        timerNodeCapacity = newCapacity;
+    }
+
+    int node = timerFreeList;
+    timerFreeList = timerNodes[node].next;
+    return node;
+}
+
+// Level 0 if it fires within one turn, otherwise the level-1 slot of its turn
+void insertTimerNode(int node) {
+    unsigned int due = timerNodes[node].due;
+    unsigned int delta = due - timerWheelTick;
+    int* head;
+
+    if (delta < (unsigned int)TIMER_WHEEL_SLOTS) {
+        head = &timerWheel[due % TIMER_WHEEL_SLOTS];
+    } else {
+        // Too far out for the outer ring - park in its last slot and re-cascade later
+        unsigned int maxDelta = (unsigned int)(TIMER_WHEEL_SLOTS * (TIMER_WHEEL_OUTER_SLOTS - 1));
+        unsigned int slotTick = (delta < maxDelta) ? due : timerWheelTick + maxDelta;
+        head = &timerWheelOuter[(slotTick / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_OUTER_SLOTS];
+    }
+
+    timerNodes[node].next = *head;
+    *head = node;
+}
+
+// Fire everything due up to the current tick. Only expired slots are
+// touched, so idle enemies cost nothing here.
+void advanceTimerWheel() {
+    if (!timerWheelReady) return;
+
+    while (timerWheelTick <= currentTick) {
+        // Start of a new turn: move the matching outer slot down a level
+        if (timerWheelTick % TIMER_WHEEL_SLOTS == 0) {
+            int& outer = timerWheelOuter[(timerWheelTick / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_OUTER_SLOTS];
+            int node = outer;
+            outer = -1;
+            while (node >= 0) {
+                int next = timerNodes[node].next;
+                insertTimerNode(node);
+                node = next;
+            }
+        }
+
+        int& slot = timerWheel[timerWheelTick % TIMER_WHEEL_SLOTS];
+        int node = slot;
+        slot = -1;
+        while (node >= 0) {
+            int next = timerNodes[node].next;
+            int enemyId = timerNodes[node].enemyId;
+            int kind = timerNodes[node].kind;
+
+            // Release before firing - the handler may schedule again
+            timerNodes[node].next = timerFreeList;
+            timerFreeList = node;
+            fireTimer(enemyId, kind);
+            node = next;
+        }
+        timerWheelTick++;
+    }
+}
+
+// Timed state changes. An enemy that doesn't update this tick (LOD) keeps
+// the timer parked on itself until scheduleEnemyUpdates() picks it again,
+// so a sleeping enemy costs nothing here however long it sleeps.
+void fireTimer(int enemyId, int kind) {
+    int index = enemyIndexById[enemyId];
+    if (index < 0) return; // Removed since
+
+    if (!isEnemyScheduled(index)) {
+        int node = allocateTimerNode();
+        timerNodes[node].enemyId = enemyId;
+        timerNodes[node].kind = kind;
+        timerNodes[node].due = currentTick;
+        timerNodes[node].next = enemies[index].parkedTimers;
+        enemies[index].parkedTimers = node;
+        return;
+    }
+
+    Enemy& enemy = enemies[index];
+    switch (kind) {
+        case TIMER_FLIER_DESCENT:
+            // Descends at the end of this tick's movement
+            enemy.descentDue = true;
+            break;
+        case TIMER_FLIER_SHOT:
+            // Drop a shot on a visible player passing below
+            if (player.y > enemy.y && hasLineOfSight(enemy.x, enemy.y) &&
+                player.x - enemy.x <= FLIER_SHOT_RANGE && enemy.x - player.x <= FLIER_SHOT_RANGE) {
+                spawnProjectile(enemy.x, enemy.y + 1, 0, 1, enemy.type);
+            }
+            scheduleTimer(enemyId, TIMER_FLIER_SHOT, FLIER_SHOT_INTERVAL);
+            break;
+        case TIMER_BOSS_WINDUP:
+            enemy.attackState = 1;
+            scheduleTimer(enemyId, TIMER_BOSS_TRIGGER, BOSS_WINDUP_TIME);
+            break;
+        case TIMER_BOSS_TRIGGER:
+            enemy.attackState = 2;
+            scheduleTimer(enemyId, TIMER_BOSS_BLAST, 1);
+            break;
+        case TIMER_BOSS_BLAST:
+            // Attack frame - 11x11 blast, the collision stage decides who is caught
+            queueBlast(index, BOSS_AOE_RANGE, BOSS_DAMAGE);
+            scheduleTimer(enemyId, TIMER_BOSS_RECOVER, 1);
+            break;
+        case TIMER_BOSS_RECOVER:
+            enemy.attackState = 0;
+            scheduleTimer(enemyId, TIMER_BOSS_WINDUP, BOSS_ATTACK_INTERVAL - 1);
+            break;
+    }
+}
+
+// Put parked timers back on the wheel to fire this tick - called before
+// advanceTimerWheel() on a tick the enemy updates
+void rearmParkedTimers(Enemy& enemy) {
+    int node = enemy.parkedTimers;
+    enemy.parkedTimers = -1;
+    while (node >= 0) {
+        int next = timerNodes[node].next;
+        timerNodes[node].due = (currentTick < timerWheelTick) ? timerWheelTick : currentTick;
+        insertTimerNode(node);
+        node = next;
+    }
+}
+
+// Enemy removed - its parked timers go straight back to the free list
+void releaseParkedTimers(Enemy& enemy) {
+    int node = enemy.parkedTimers;
+    enemy.parkedTimers = -1;
+    while (node >= 0) {
+        int next = timerNodes[node].next;
+        timerNodes[node].next = timerFreeList;
+        timerFreeList = node;
+        node = next;
+    }
+}
+
+void cleanupTimerWheel() {
+    delete[] timerNodes;
+    timerNodes = nullptr;
+    timerNodeCapacity = 0;
+    timerFreeList = -1;
+    timerWheelReady = false;
+}
+
+// ========================================
+// COLLISION STAGE
+// ========================================
+
+// Boss blast centered on the enemy - tested in detectCollisions()
+void queueBlast(int enemyIndex, int range, int damage) {
+    if (pendingBlastCount >= pendingBlastCapacity) {
+        int newCapacity = (pendingBlastCapacity == 0) ? 4 : pendingBlastCapacity * 2;
+        AoeBlast* newBlasts = new AoeBlast[newCapacity];
+        for (int i = 0; i < pendingBlastCount; i++) {
+            newBlasts[i] = pendingBlasts[i];
+        }
+        delete[] pendingBlasts;
+        pendingBlasts = newBlasts;
+        pendingBlastCapacity = newCapacity;
+    }
+
+    AoeBlast& blast = pendingBlasts[pendingBlastCount++];
+    blast.enemyIndex = enemyIndex;
+    blast.x = enemies[enemyIndex].x;
+    blast.y = enemies[enemyIndex].y;
+    blast.range = range;
+    blast.damage = damage;
+}
+
+void emitHitEvent(int kind, int enemyIndex, int damage, char source) {
+    if (hitEventCount >= hitEventCapacity) {
+        int newCapacity = (hitEventCapacity == 0) ? 16 : hitEventCapacity * 2;
+        HitEvent* newEvents = new HitEvent[newCapacity];
+        for (int i = 0; i < hitEventCount; i++) {
+            newEvents[i] = hitEvents[i];
+        }
+        delete[] hitEvents;
+        hitEvents = newEvents;
+        hitEventCapacity = newCapacity;
+    }
+
+    HitEvent& event = hitEvents[hitEventCount++];
+    event.kind = kind;
+    event.enemyIndex = enemyIndex;
+    event.damage = damage;
+    event.source = source;
+}
+
+// One pass per tick over everything that can hurt something. Broad phase is
+// the batch overlap kernel on each enemy's footprint plus fall sweep, narrow
+// phase checks the exact shapes. Nothing else is changed here (projectiles
+// only advance) - events are applied by resolveHitEvents().
+void detectCollisions() {
+    hitEventCount = 0;
+    gatherEnemyBatch();
+
+    // Attack -> enemy: the first enemy (by index) in the hitbox, either where
+    // it ended up or anywhere it passed while falling or jumping
+    if (currentAttack.isActive) {
+        int x0, y0, x1, y1;
+        getAttackRect(x0, y0, x1, y1);
+        computeOverlapMask(x0, y0, x1, y1);
+
+        for (int i = 0; i < enemyCount; i++) {
+            if (!batchMask[i]) continue;
+
+            const Enemy& enemy = enemies[i];
+            const EnemyTraits& traits = traitsOf(enemy.type);
+            bool hit = rectsOverlap(enemy.x - traits.halfWidth, enemy.y - traits.halfHeight,
+                                    enemy.x + traits.halfWidth, enemy.y + traits.halfHeight,
+                                    x0, y0, x1, y1);
+            if (!hit && enemy.sweepTop <= enemy.sweepBottom) {
+                hit = rectsOverlap(enemy.sweepX - traits.halfWidth, enemy.sweepTop - traits.halfHeight,
+                                   enemy.sweepX + traits.halfWidth, enemy.sweepBottom + traits.halfHeight,
+                                   x0, y0, x1, y1);
+            }
+            if (hit) {
+                emitHitEvent(HIT_ATTACK_ENEMY, i, 1, '@');
+                break;
+            }
+        }
+    }
+
+    // Boss blasts -> player
+    for (int b = 0; b < pendingBlastCount; b++) {
+        const AoeBlast& blast = pendingBlasts[b];
+        if (rectsOverlap(blast.x - blast.range, blast.y - blast.range,
+                         blast.x + blast.range, blast.y + blast.range,
+                         player.x, player.y, player.x, player.y)) {
+            emitHitEvent(HIT_AOE_PLAYER, blast.enemyIndex, blast.damage, enemies[blast.enemyIndex].type);
+        }
+    }
+    pendingBlastCount = 0;
+
+    // Enemy -> player: contact uses the final footprint only
+    computeOverlapMask(player.x, player.y, player.x, player.y);
+    for (int i = 0; i < enemyCount; i++) {
+        if (!batchMask[i]) continue;
+
+        const Enemy& enemy = enemies[i];
+        const EnemyTraits& traits = traitsOf(enemy.type);
+        if (rectsOverlap(enemy.x - traits.halfWidth, enemy.y - traits.halfHeight,
+                         enemy.x + traits.halfWidth, enemy.y + traits.halfHeight,
+                         player.x, player.y, player.x, player.y)) {
+            emitHitEvent(HIT_ENEMY_PLAYER, i, 1, enemy.type);
+        }
+    }
+
+    // Projectiles -> tiles, enemies, player
+    sweepProjectiles();
+}
+
+// Apply this tick's events in order, then drop defeated enemies in one pass
+void resolveHitEvents() {
+    for (int e = 0; e < hitEventCount; e++) {
+        const HitEvent& event = hitEvents[e];
+
+        if (event.kind == HIT_SHOT_PLAYER) {
+            player.hp -= event.damage;
+            logEvent(EVENT_PLAYER_DAMAGE, event.source, player.x, player.y, event.damage);
+            continue;
+        }
+
+        Enemy& enemy = enemies[event.enemyIndex];
+
+        if (event.kind == HIT_SHOT_ENEMY) {
+            // Several shots can reach the same enemy in one tick
+            if (!enemy.isActive) continue;
+
+            enemy.hp -= event.damage;
+            logEvent(EVENT_HIT, enemy.type, enemy.x, enemy.y, enemy.hp);
+            if (enemy.hp <= 0) {
+                enemy.isActive = false;
+                logEvent(EVENT_KILL, enemy.type, enemy.x, enemy.y, 0);
+            }
+        } else if (event.kind == HIT_ATTACK_ENEMY) {
+            enemy.hp -= event.damage;
+            logEvent(EVENT_HIT, enemy.type, enemy.x, enemy.y, enemy.hp);
+            if (enemy.hp <= 0) {
+                enemy.isActive = false;
+                logEvent(EVENT_KILL, enemy.type, enemy.x, enemy.y, 0);
+            }
+            currentAttack.isActive = false;
+        } else if (event.kind == HIT_AOE_PLAYER) {
+            player.hp -= event.damage;
+            logEvent(EVENT_PLAYER_DAMAGE, enemy.type, player.x, player.y, event.damage);
+        } else if (event.kind == HIT_ENEMY_PLAYER) {
+            // An enemy killed by the attack this tick can't touch the player
+            if (!enemy.isActive) continue;
+
+            player.hp -= event.damage;
+            logEvent(EVENT_PLAYER_DAMAGE, enemy.type, player.x, player.y, event.damage);
+
+            // Regular enemies die on contact, Boss doesn't
+            if (traitsOf(enemy.type).diesOnContact) {
+                enemy.isActive = false;
+            }
+        }
+    }
+
+    // Stable compaction keeps the spawn order (and so the draw order)
+    int kept = 0;
+    for (int i = 0; i < enemyCount; i++) {
+        if (!enemies[i].isActive) {
+            enemyIndexById[enemies[i].id] = -1;
+            releaseParkedTimers(enemies[i]);
+            continue;
+        }
+        if (kept != i) {
+            enemies[kept] = enemies[i];
+            enemyIndexById[enemies[kept].id] = kept;
+        }
+        kept++;
+    }
+    enemyCount = kept;
+    hitEventCount = 0;
+}
+
+void cleanupCollisionStage() {
+    delete[] hitEvents;
+    delete[] pendingBlasts;
+    hitEvents = nullptr;
+    pendingBlasts = nullptr;
+    hitEventCount = hitEventCapacity = 0;
+    pendingBlastCount = pendingBlastCapacity = 0;
+}
+
+// ========================================
+// PROJECTILES
+// ========================================
+
+// Claim a pool slot - returns false (shot dropped) when the pool is full
+bool spawnProjectile(int x, int y, int velocityX, int velocityY, char source) {
+    if (projectileCount >= PROJECTILE_CAPACITY || isColliding(x, y)) return false;
+
+    int p = projectileCount++;
+    projectileX[p] = (short)x;
+    projectileY[p] = (short)y;
+    projectileVelocityX[p] = (signed char)velocityX;
+    projectileVelocityY[p] = (signed char)velocityY;
+    projectileSource[p] = source;
+    return true;
+}
+
+void firePlayerShot() {
+    if (playerShotCooldown > 0) return;
+
+    if (spawnProjectile(player.x + player.facing, player.y, player.facing * PLAYER_SHOT_SPEED, 0, '@')) {
+        playerShotCooldown = PLAYER_SHOT_COOLDOWN;
+    }
+}
+
+// One write per footprint cell, lower index wins a shared cell
+void buildEnemyOccupancy() {
+    memset(enemyAtCell, 0xFF, sizeof(enemyAtCell));
+
+    for (int i = 0; i < enemyCount; i++) {
+        if (!enemies[i].isActive) continue;
+
+        const EnemyTraits& traits = traitsOf(enemies[i].type);
+        for (int y = enemies[i].y - traits.halfHeight; y <= enemies[i].y + traits.halfHeight; y++) {
+            if (y < 0 || y >= ARENA_HEIGHT) continue;
+            for (int x = enemies[i].x - traits.halfWidth; x <= enemies[i].x + traits.halfWidth; x++) {
+                if (x < 0 || x >= ARENA_WIDTH || enemyAtCell[y][x] >= 0) continue;
+                enemyAtCell[y][x] = i;
+            }
+        }
+    }
+}
+
+// Move every projectile cell by cell and test each cell against tiles
+// (solidity map), enemies (occupancy grid) or the player. The cell a shot
+// starts in is tested first - it may have just been spawned next to its
+// target, or the target moved into it. Hits become events, spent shots are
+// swap-removed from the pool.
+void sweepProjectiles() {
+    if (projectileCount == 0) return;
+
+    bool playerShotsLive = false;
+    for (int p = 0; p < projectileCount; p++) {
+        if (projectileSource[p] == '@') {
+            playerShotsLive = true;
+            break;
+        }
+    }
+    if (playerShotsLive) {
+        buildEnemyOccupancy();
+    }
+
+    int p = 0;
+    while (p < projectileCount) {
+        int x = projectileX[p];
+        int y = projectileY[p];
+        int velocityX = projectileVelocityX[p];
+        int velocityY = projectileVelocityY[p];
+        int stepX = (velocityX > 0) - (velocityX < 0);
+        int stepY = (velocityY > 0) - (velocityY < 0);
+        int speedX = velocityX * stepX;
+        int speedY = velocityY * stepY;
+        int steps = (speedX > speedY) ? speedX : speedY;
+        bool isPlayerShot = projectileSource[p] == '@';
+        bool spent = false;
+
+        for (int s = 0; s <= steps && !spent; s++) {
+            if (s > 0) {
+                if (s <= speedX) x += stepX;
+                if (s <= speedY) y += stepY;
+            }
+
+            if (isColliding(x, y)) {
+                spent = true;
+            } else if (isPlayerShot) {
+                int target = enemyAtCell[y][x];
+                if (target >= 0) {
+                    emitHitEvent(HIT_SHOT_ENEMY, target, PROJECTILE_DAMAGE, '@');
+                    spent = true;
+                }
+            } else if (x == player.x && y == player.y) {
+                emitHitEvent(HIT_SHOT_PLAYER, -1, PROJECTILE_DAMAGE, projectileSource[p]);
+                spent = true;
+            }
+        }
+
+        if (spent) {
+            // Last shot takes this slot and is processed next
+            projectileCount--;
+            projectileX[p] = projectileX[projectileCount];
+            projectileY[p] = projectileY[projectileCount];
+            projectileVelocityX[p] = projectileVelocityX[projectileCount];
+            projectileVelocityY[p] = projectileVelocityY[projectileCount];
+            projectileSource[p] = projectileSource[projectileCount];
+        } else {
+            projectileX[p] = (short)x;
+            projectileY[p] = (short)y;
+            p++;
+        }
+    }
+}
+
+// Player shots as '-', enemy shots as '|' in the shooter's color
+void rasterizeProjectiles() {
+    for (int p = 0; p < projectileCount; p++) {
+        if (projectileSource[p] == '@') {
+            stampLayer(attackLayer, projectileX[p], projectileY[p], '-', 0, true);
+        } else {
+            stampLayer(attackLayer, projectileX[p], projectileY[p], '|', projectileSource[p], true);
+        }
+    }
+}
+
+// Free dynamically allocated enemy array
+void cleanupEnemies() {
+    if (enemies != nullptr) {
+        delete[] enemies;
+        enemies = nullptr;
+    }
+
+    delete[] batchX;
+    delete[] batchY;
+    delete[] batchLeft;
+    delete[] batchRight;
+    delete[] batchTop;
+    delete[] batchBottom;
+    delete[] batchVelocityX;
+    delete[] batchOnGround;
+    delete[] batchSees;
+    delete[] batchMask;
+    delete[] planJump;
+    batchX = batchY = batchLeft = batchRight = batchTop = batchBottom = nullptr;
+    batchVelocityX = batchOnGround = batchSees = nullptr;
+    batchMask = planJump = nullptr;
+    batchCapacity = 0;
+
+    delete[] lodScheduled;
+    lodScheduled = nullptr;
+    lodCapacity = 0;
     enemyCount = 0;
     enemyCapacity = 0;
 }
@@ -1524,79 +4336,1686 @@ void cleanupEnemies() {
 
 // Check if current wave is complete (all enemies defeated)
 bool isWaveComplete() {
-    return enemyCount == 0;
+    return enemyCount == 0 && enemyCountToSpawn == 0;
 }
 
-// Spawn enemies for a given wave number
+// Queue the spawn plan for a wave - the curve's burst is placed right away,
+// the rest is released by the spawn director over the following ticks
 void spawnWave(int waveNumber) {
-    int enemiesToSpawn = 0;
+    spawnQueueHead = 0;
+    enemyCountToSpawn = 0;
+    activeSpawnCurve = WAVE_SPAWN_CURVES[waveNumber];
 
     // Wave 1: Tutorial wave with basic enemies
     if (waveNumber == 1) {
-        addEnemy('E', 20, ARENA_HEIGHT - 2);
-        addEnemy('E', 100, ARENA_HEIGHT - 2);
+        queueSpawn('E', 20, ARENA_HEIGHT - 2);
+        queueSpawn('E', 100, ARENA_HEIGHT - 2);
         totalEnemiesFromPreviousWaves = 2;
-        return;
     }
     // Final wave: Boss battle
     else if (waveNumber == MAX_WAVES) {
         int bossX = ARENA_WIDTH / 2;
         int bossY = ARENA_HEIGHT - 3;
-        addEnemy('B', bossX, bossY);
+        queueSpawn('B', bossX, bossY);
         totalEnemiesFromPreviousWaves = 1;
-        return;
     }
     // Intermediate waves: increasing difficulty
     else {
         int additionalEnemies = 2 + (rand() % 3);
-        enemiesToSpawn = totalEnemiesFromPreviousWaves + additionalEnemies;
+        int enemiesToSpawn = totalEnemiesFromPreviousWaves + additionalEnemies;
         totalEnemiesFromPreviousWaves = enemiesToSpawn;
-    }
 
-    char enemyTypes[] = {'E', 'J', 'F', 'C'};
+        for (int i = 0; i < enemiesToSpawn * waveScale; i++) {
+            queueSpawn('?', -1, -1);
+        }
+    }
 
-    for (int i = 0; i < enemiesToSpawn; i++) {
-        char type = enemyTypes[rand() % 4];
-        int spawnX, spawnY;
+    releaseSpawns(activeSpawnCurve.burst, 0);
+}
 
-        if (type == 'F') {
-            // Fliers spawn in the air
-            spawnY = 2 + rand() % (ARENA_HEIGHT / 2); // top half of arena
-            spawnX = 1 + rand() % (ARENA_WIDTH - 2);
-        }
-        else {
-            // Decide randomly: ground or platform
-            bool spawnOnGround = (rand() % 2 == 0);
+// ========================================
+// SPAWN DIRECTOR
+// ========================================
 
-            if (spawnOnGround) {
-                spawnY = ARENA_HEIGHT - 2;
-                spawnX = 1 + rand() % (ARENA_WIDTH - 2);
-            }
-            else {
-                // Choose a platform row
-                int platformYs[] = {ARENA_HEIGHT - 6, ARENA_HEIGHT - 12, ARENA_HEIGHT - 18};
-                spawnY = platformYs[rand() % 3];
-
-                // Find valid X positions on this platform
-                int validXs[ARENA_WIDTH];
-                int count = 0;
-                for (int x = 1; x < ARENA_WIDTH - 1; x++) {
-                    if (arena[spawnY][x] == '=') validXs[count++] = x;
-                }
+void queueSpawn(char type, int x, int y) {
+    int used = spawnQueueHead + enemyCountToSpawn;
 
-                if (count == 0) {
-                    // fallback to ground
-                    spawnY = ARENA_HEIGHT - 2;
-                    spawnX = 1 + rand() % (ARENA_WIDTH - 2);
-                } else {
-                    spawnX = validXs[rand() % count];
-                }
+    // Expand queue if capacity reached (double the size)
+    if (used >= spawnQueueCapacity) {
+        int newCapacity = (spawnQueueCapacity == 0) ? 64 : spawnQueueCapacity * 2;
+        SpawnOrder* newQueue = new SpawnOrder[newCapacity];
 
-                spawnY--; // spawn above platform
-            }
+        for (int i = 0; i < enemyCountToSpawn; i++) {
+            newQueue[i] = spawnQueue[spawnQueueHead + i];
         }
 
-        addEnemy(type, spawnX, spawnY);
+        delete[] spawnQueue;
+        spawnQueue = newQueue;
+        spawnQueueCapacity = newCapacity;
+        spawnQueueHead = 0;
+        used = enemyCountToSpawn;
     }
 
+    spawnQueue[used].type = type;
+    spawnQueue[used].x = x;
+    spawnQueue[used].y = y;
+    enemyCountToSpawn++;
+}
+
+// Place up to maxCount queued enemies; budgetMicros > 0 also stops the
+// release once that much time has been spent. Returns the number placed.
+int releaseSpawns(int maxCount, int budgetMicros) {
+    // A fixed seed must give the same waves on every machine, so no time budget then
+    long long deadline = (budgetMicros > 0 && !deterministicMode) ? nowMicroseconds() + budgetMicros : 0;
+    int released = 0;
+
+    while (released < maxCount && enemyCountToSpawn > 0) {
+        SpawnOrder order = spawnQueue[spawnQueueHead];
+        spawnQueueHead++;
+        enemyCountToSpawn--;
+
+        if (order.type == '?') {
+            spawnRandomEnemy();
+        } else {
+            addEnemy(order.type, order.x, order.y);
+        }
+        released++;
+
+        // Checking the clock is not free - only do it every few spawns
+        if (deadline != 0 && released % 16 == 0 && nowMicroseconds() >= deadline) {
+            break;
+        }
+    }
+
+    if (enemyCountToSpawn == 0) {
+        spawnQueueHead = 0;
+    }
+    return released;
+}
+
+// Per-tick release according to the current wave's curve
+void updateSpawnDirector() {
+    if (enemyCountToSpawn == 0) return;
+    releaseSpawns(activeSpawnCurve.perTick, activeSpawnCurve.budgetMicros);
+}
+
+// Random enemy from the regular mix, on the ground, a platform or in the air
+void spawnRandomEnemy() {
+    char enemyTypes[] = {'E', 'J', 'F', 'C'};
+
+    char type = enemyTypes[rand() % 4];
+    int spawnX, spawnY;
+
+    if (type == 'F') {
+        // Fliers spawn in the air
+        spawnY = 2 + rand() % (ARENA_HEIGHT / 2); // top half of arena
+        spawnX = 1 + rand() % (ARENA_WIDTH - 2);
+    }
+    else {
+        // Decide randomly: ground or platform
+        bool spawnOnGround = (rand() % 2 == 0);
+
+        if (spawnOnGround) {
+            spawnY = ARENA_HEIGHT - 2;
+            spawnX = 1 + rand() % (ARENA_WIDTH - 2);
+        }
+        else {
+            // Choose a platform row
+            int platformYs[] = {ARENA_HEIGHT - 6, ARENA_HEIGHT - 12, ARENA_HEIGHT - 18};
+            spawnY = platformYs[rand() % 3];
+
+            // Valid X positions on this platform come from the spawn-surface index
+            int count = spawnSurfaceCount[spawnY];
+
+            if (count == 0) {
+                // fallback to ground
+                spawnY = ARENA_HEIGHT - 2;
+                spawnX = 1 + rand() % (ARENA_WIDTH - 2);
+            } else {
+                spawnX = spawnSurfaceX[spawnY][rand() % count];
+            }
+
+            spawnY--; // spawn above platform
+        }
+    }
+
+    addEnemy(type, spawnX, spawnY);
+}
+
+void cleanupSpawnQueue() {
+    delete[] spawnQueue;
+    spawnQueue = nullptr;
+    spawnQueueCapacity = 0;
+    spawnQueueHead = 0;
+    enemyCountToSpawn = 0;
+}
+
+// ========================================
+// WORLD HASH
+// ========================================
+
+// One step of FNV-1a over a whole word
+unsigned long long mixHash(unsigned long long hash, long long value) {
+    return (hash ^ (unsigned long long)value) * WORLD_HASH_PRIME;
+}
+
+// Well-spread 64-bit key for order-independent (XOR/sum) hashes
+unsigned long long splitMix64(unsigned long long value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Zobrist key of one tile - setTile() swaps keys in and out of terrainHash
+unsigned long long hashTile(int cell, char tile) {
+    return splitMix64(((unsigned long long)cell << 8) | (unsigned char)tile);
+}
+
+unsigned long long hashTerrain() {
+    unsigned long long hash = 0;
+    for (int i = 0; i < ARENA_HEIGHT; i++) {
+        for (int j = 0; j < ARENA_WIDTH; j++) {
+            hash ^= hashTile(i * ARENA_WIDTH + j, arena[i][j]);
+        }
+    }
+    return hash;
+}
+
+// Pending timers - summed, so the order inside a wheel slot doesn't matter.
+// Timers parked on LOD-skipped enemies count as well.
+unsigned long long hashTimers() {
+    if (!timerWheelReady) return 0;
+
+    unsigned long long hash = 0;
+    for (int i = 0; i < enemyCount; i++) {
+        for (int node = enemies[i].parkedTimers; node >= 0; node = timerNodes[node].next) {
+            hash += splitMix64(((unsigned long long)timerNodes[node].enemyId << 32) ^
+                               ((unsigned long long)timerNodes[node].kind << 24) ^ timerNodes[node].due);
+        }
+    }
+    for (int ring = 0; ring < 2; ring++) {
+        const int* heads = (ring == 0) ? timerWheel : timerWheelOuter;
+        int slots = (ring == 0) ? TIMER_WHEEL_SLOTS : TIMER_WHEEL_OUTER_SLOTS;
+        for (int slot = 0; slot < slots; slot++) {
+            for (int node = heads[slot]; node >= 0; node = timerNodes[node].next) {
+                hash += splitMix64(((unsigned long long)timerNodes[node].enemyId << 32) ^
+                                   ((unsigned long long)timerNodes[node].kind << 24) ^ timerNodes[node].due);
+            }
+        }
+    }
+    return hash;
+}
+
+// Everything that carries over to the next tick except the random generator.
+// Terrain comes from the incrementally kept terrainHash, the rest costs one
+// multiply per field.
+unsigned long long hashWorldState() {
+    unsigned long long hash = WORLD_HASH_OFFSET;
+    hash = mixHash(hash, currentTick);
+    hash = mixHash(hash, currentWave);
+    hash = mixHash(hash, waveInProgress);
+    hash = mixHash(hash, totalEnemiesFromPreviousWaves);
+
+    hash = mixHash(hash, player.x);
+    hash = mixHash(hash, player.y);
+    hash = mixHash(hash, player.hp);
+    hash = mixHash(hash, player.velocityY);
+    hash = mixHash(hash, player.isOnGround);
+    hash = mixHash(hash, player.canDoubleJump);
+    hash = mixHash(hash, player.facing);
+
+    hash = mixHash(hash, currentAttack.isActive);
+    hash = mixHash(hash, currentAttack.direction);
+    hash = mixHash(hash, currentAttack.x);
+    hash = mixHash(hash, currentAttack.y);
+    hash = mixHash(hash, currentAttack.framesRemaining);
+    hash = mixHash(hash, attackCooldown);
+    hash = mixHash(hash, playerShotCooldown);
+
+    hash = mixHash(hash, enemyCount);
+    hash = mixHash(hash, enemyCountToSpawn);
+    for (int i = 0; i < enemyCount; i++) {
+        const Enemy& enemy = enemies[i];
+        hash = mixHash(hash, enemy.type);
+        hash = mixHash(hash, enemy.x);
+        hash = mixHash(hash, enemy.y);
+        hash = mixHash(hash, enemy.velocityX);
+        hash = mixHash(hash, enemy.velocityY);
+        hash = mixHash(hash, enemy.hp);
+        hash = mixHash(hash, enemy.isActive);
+        hash = mixHash(hash, enemy.isOnGround);
+        hash = mixHash(hash, enemy.id);
+        hash = mixHash(hash, enemy.surface);
+        hash = mixHash(hash, enemy.edgeWrapStep);
+        hash = mixHash(hash, enemy.attackState);
+        hash = mixHash(hash, enemy.descentDue);
+        hash = mixHash(hash, enemy.isOnArc);
+        hash = mixHash(hash, enemy.arcDirection);
+        hash = mixHash(hash, enemy.alertTimer);
+    }
+
+    hash = mixHash(hash, projectileCount);
+    for (int p = 0; p < projectileCount; p++) {
+        hash = mixHash(hash, projectileX[p]);
+        hash = mixHash(hash, projectileY[p]);
+        hash = mixHash(hash, projectileVelocityX[p]);
+        hash = mixHash(hash, projectileVelocityY[p]);
+        hash = mixHash(hash, projectileSource[p]);
+    }
+
+    hash = mixHash(hash, (long long)terrainHash);
+    hash = mixHash(hash, (long long)hashTimers());
+    return hash;
+}
+
+// ========================================
+// DIFFERENTIAL RUNNER
+// ========================================
+
+// Two forked headless games with the same seed, options and bot - one on the
+// scalar reference path, one on the best batch kernel - stepped in lockstep.
+// Each tick both send their world hash; on the first mismatch both send their
+// full state and the differing fields are listed.
+
+void fillWorldSnapshot(WorldSnapshot& snapshot) {
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.tick = currentTick;
+    snapshot.wave = currentWave;
+    snapshot.player = player;
+    snapshot.attack = currentAttack;
+    snapshot.attackCooldown = attackCooldown;
+    snapshot.playerShotCooldown = playerShotCooldown;
+    snapshot.enemyCount = enemyCount;
+    snapshot.enemyCountToSpawn = enemyCountToSpawn;
+    snapshot.projectileCount = projectileCount;
+    snapshot.terrainHash = terrainHash;
+    snapshot.timerHash = hashTimers();
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+#ifdef _WIN32
+    (void)fd;
+    (void)data;
+    return size == 0;
+#else
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        ssize_t result = write(fd, bytes, size);
+        if (result <= 0) return false;
+        bytes += result;
+        size -= (size_t)result;
+    }
+    return true;
+#endif
+}
+
+bool readAll(int fd, void* data, size_t size) {
+#ifdef _WIN32
+    (void)fd;
+    (void)data;
+    return size == 0;
+#else
+    char* bytes = (char*)data;
+    while (size > 0) {
+        ssize_t result = read(fd, bytes, size);
+        if (result <= 0) return false;
+        bytes += result;
+        size -= (size_t)result;
+    }
+    return true;
+#endif
+}
+
+// Snapshot, the enemy array, then five shorts per projectile
+bool sendWorldState(int fd) {
+    WorldSnapshot snapshot;
+    fillWorldSnapshot(snapshot);
+    if (!writeAll(fd, &snapshot, sizeof(snapshot))) return false;
+    if (!writeAll(fd, enemies, sizeof(Enemy) * enemyCount)) return false;
+
+    for (int p = 0; p < projectileCount; p++) {
+        short shot[5] = {projectileX[p], projectileY[p], projectileVelocityX[p], projectileVelocityY[p],
+                         projectileSource[p]};
+        if (!writeAll(fd, shot, sizeof(shot))) return false;
+    }
+    return true;
+}
+
+// Returns the enemy array (caller deletes it), nullptr if the run went away
+Enemy* receiveWorldState(int fd, WorldSnapshot& snapshot, short* shots) {
+    if (!readAll(fd, &snapshot, sizeof(snapshot))) return nullptr;
+
+    Enemy* received = new Enemy[snapshot.enemyCount + 1];
+    if (!readAll(fd, received, sizeof(Enemy) * snapshot.enemyCount) ||
+        !readAll(fd, shots, sizeof(short) * 5 * snapshot.projectileCount)) {
+        delete[] received;
+        return nullptr;
+    }
+    return received;
+}
+
+void compareField(const char* group, int index, const char* field, long long a, long long b,
+                  bool isChar, int& differences) {
+    if (a == b) return;
+
+    differences++;
+    if (differences > DIFF_MAX_REPORTED_FIELDS) return;
+
+    char name[64];
+    if (index >= 0) {
+        snprintf(name, sizeof(name), "%s[%d].%s", group, index, field);
+    } else {
+        snprintf(name, sizeof(name), "%s.%s", group, field);
+    }
+
+    char line[128];
+    if (isChar) {
+        snprintf(line, sizeof(line), "  %-28s '%c' vs '%c'\n", name, (char)a, (char)b);
+    } else {
+        snprintf(line, sizeof(line), "  %-28s %lld vs %lld\n", name, a, b);
+    }
+    cout << line;
+}
+
+// List fields that differ (reference first) - returns how many
+int reportWorldDifferences(const WorldSnapshot& a, const Enemy* enemiesA, const short* shotsA,
+                           const WorldSnapshot& b, const Enemy* enemiesB, const short* shotsB) {
+    int differences = 0;
+
+    compareField("world", -1, "wave", a.wave, b.wave, false, differences);
+    compareField("world", -1, "enemyCount", a.enemyCount, b.enemyCount, false, differences);
+    compareField("world", -1, "enemyCountToSpawn", a.enemyCountToSpawn, b.enemyCountToSpawn, false, differences);
+    compareField("world", -1, "projectileCount", a.projectileCount, b.projectileCount, false, differences);
+    compareField("world", -1, "terrainHash", (long long)a.terrainHash, (long long)b.terrainHash, false, differences);
+    compareField("world", -1, "timerHash", (long long)a.timerHash, (long long)b.timerHash, false, differences);
+
+    compareField("player", -1, "x", a.player.x, b.player.x, false, differences);
+    compareField("player", -1, "y", a.player.y, b.player.y, false, differences);
+    compareField("player", -1, "hp", a.player.hp, b.player.hp, false, differences);
+    compareField("player", -1, "velocityY", a.player.velocityY, b.player.velocityY, false, differences);
+    compareField("player", -1, "isOnGround", a.player.isOnGround, b.player.isOnGround, false, differences);
+    compareField("player", -1, "canDoubleJump", a.player.canDoubleJump, b.player.canDoubleJump, false, differences);
+    compareField("player", -1, "facing", a.player.facing, b.player.facing, false, differences);
+
+    compareField("attack", -1, "isActive", a.attack.isActive, b.attack.isActive, false, differences);
+    compareField("attack", -1, "direction", a.attack.direction, b.attack.direction, true, differences);
+    compareField("attack", -1, "x", a.attack.x, b.attack.x, false, differences);
+    compareField("attack", -1, "y", a.attack.y, b.attack.y, false, differences);
+    compareField("attack", -1, "framesRemaining", a.attack.framesRemaining, b.attack.framesRemaining, false, differences);
+    compareField("attack", -1, "cooldown", a.attackCooldown, b.attackCooldown, false, differences);
+    compareField("attack", -1, "shotCooldown", a.playerShotCooldown, b.playerShotCooldown, false, differences);
+
+    int commonEnemies = (a.enemyCount < b.enemyCount) ? a.enemyCount : b.enemyCount;
+    for (int i = 0; i < commonEnemies; i++) {
+        const Enemy& ea = enemiesA[i];
+        const Enemy& eb = enemiesB[i];
+        compareField("enemy", i, "type", ea.type, eb.type, true, differences);
+        compareField("enemy", i, "id", ea.id, eb.id, false, differences);
+        compareField("enemy", i, "x", ea.x, eb.x, false, differences);
+        compareField("enemy", i, "y", ea.y, eb.y, false, differences);
+        compareField("enemy", i, "velocityX", ea.velocityX, eb.velocityX, false, differences);
+        compareField("enemy", i, "velocityY", ea.velocityY, eb.velocityY, false, differences);
+        compareField("enemy", i, "hp", ea.hp, eb.hp, false, differences);
+        compareField("enemy", i, "isActive", ea.isActive, eb.isActive, false, differences);
+        compareField("enemy", i, "isOnGround", ea.isOnGround, eb.isOnGround, false, differences);
+        compareField("enemy", i, "surface", ea.surface, eb.surface, true, differences);
+        compareField("enemy", i, "edgeWrapStep", ea.edgeWrapStep, eb.edgeWrapStep, false, differences);
+        compareField("enemy", i, "attackState", ea.attackState, eb.attackState, false, differences);
+        compareField("enemy", i, "descentDue", ea.descentDue, eb.descentDue, false, differences);
+        compareField("enemy", i, "isOnArc", ea.isOnArc, eb.isOnArc, false, differences);
+        compareField("enemy", i, "arcDirection", ea.arcDirection, eb.arcDirection, false, differences);
+        compareField("enemy", i, "alertTimer", ea.alertTimer, eb.alertTimer, false, differences);
+    }
+
+    int commonShots = (a.projectileCount < b.projectileCount) ? a.projectileCount : b.projectileCount;
+    for (int p = 0; p < commonShots; p++) {
+        const short* sa = shotsA + 5 * p;
+        const short* sb = shotsB + 5 * p;
+        compareField("projectile", p, "x", sa[0], sb[0], false, differences);
+        compareField("projectile", p, "y", sa[1], sb[1], false, differences);
+        compareField("projectile", p, "velocityX", sa[2], sb[2], false, differences);
+        compareField("projectile", p, "velocityY", sa[3], sb[3], false, differences);
+        compareField("projectile", p, "source", sa[4], sb[4], true, differences);
+    }
+
+    if (differences > DIFF_MAX_REPORTED_FIELDS) {
+        cout << "  ... and " << differences - DIFF_MAX_REPORTED_FIELDS << " more\n";
+    }
+    return differences;
+}
+
+// One side of the lockstep: 'n' runs a tick and answers with the world hash and
+// how the game stands (0 running, 1 won, 2 lost, 3 tick limit), 'd' sends the
+// full state, anything else ends the run
+void runDifferentialChild(int kernelLevel, int commandFd, int resultFd) {
+    srand(gameSeed);
+    headlessMode = true;
+    worldHashing = true;
+    if (!setupWorld()) return;
+
+    batchKernelLevel = kernelLevel;
+    currentAttack.isActive = false;
+    beginFirstWave();
+    worldHash = hashWorldState();
+
+    char command;
+    while (readAll(commandFd, &command, 1)) {
+        if (command == 'n') {
+            int state = 0;
+            advanceWaves();
+            if (checkGameOver()) {
+                state = playerWon ? 1 : (player.hp <= 0) ? 2 : 3;
+            } else {
+                processInput();
+                updateGame();
+            }
+            if (!writeAll(resultFd, &worldHash, sizeof(worldHash)) || !writeAll(resultFd, &state, sizeof(state))) {
+                break;
+            }
+        } else if (command == 'd') {
+            if (!sendWorldState(resultFd)) break;
+        } else {
+            break;
+        }
+    }
+
+    cleanupEnemies();
+    cleanupCollisionStage();
+    cleanupTimerWheel();
+    cleanupSpawnQueue();
+}
+
+int runDifferential() {
+#ifdef _WIN32
+    cerr << "Differential mode is not supported on this platform\n";
+    return 1;
+#else
+    if (!deterministicMode) {
+        gameSeed = (unsigned int)time(nullptr);
+        deterministicMode = true;
+    }
+
+    selectBatchKernels();
+    const int levels[2] = {KERNEL_SCALAR, batchKernelLevel};
+    cout << "Differential run (seed " << gameSeed << "): " << KERNEL_NAMES[levels[0]] << " reference vs "
+         << KERNEL_NAMES[levels[1]] << "\n";
+    if (levels[1] == KERNEL_SCALAR) {
+        cout << "  no batch kernels on this machine, both sides take the scalar path\n";
+    }
+    cout << flush;
+
+    // A side that dies must not take the runner with it
+    signal(SIGPIPE, SIG_IGN);
+
+    int commandFds[2], resultFds[2];
+    pid_t children[2];
+    for (int side = 0; side < 2; side++) {
+        int toChild[2], fromChild[2];
+        if (pipe(toChild) != 0 || pipe(fromChild) != 0) {
+            cerr << "Could not create pipes\n";
+            return 1;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Could not start a differential run\n";
+            return 1;
+        }
+        if (pid == 0) {
+            close(toChild[1]);
+            close(fromChild[0]);
+            for (int other = 0; other < side; other++) {
+                close(commandFds[other]);
+                close(resultFds[other]);
+            }
+            runDifferentialChild(levels[side], toChild[0], fromChild[1]);
+            _exit(0);
+        }
+
+        close(toChild[0]);
+        close(fromChild[1]);
+        commandFds[side] = toChild[1];
+        resultFds[side] = fromChild[0];
+        children[side] = pid;
+    }
+
+    const char* outcomes[] = {"running", "won", "lost", "stopped at the tick limit"};
+    int result = 0;
+    while (true) {
+        unsigned long long hashes[2];
+        int states[2];
+        bool ok = true;
+        for (int side = 0; side < 2; side++) {
+            ok = ok && writeAll(commandFds[side], "n", 1);
+        }
+        for (int side = 0; side < 2; side++) {
+            ok = ok && readAll(resultFds[side], &hashes[side], sizeof(hashes[side])) &&
+                 readAll(resultFds[side], &states[side], sizeof(states[side]));
+        }
+        if (!ok) {
+            cerr << "A differential run stopped unexpectedly\n";
+            result = 1;
+            break;
+        }
+
+        if (hashes[0] != hashes[1] || states[0] != states[1]) {
+            static short shots[2][PROJECTILE_CAPACITY * 5];
+            WorldSnapshot snapshots[2];
+            Enemy* received[2] = {nullptr, nullptr};
+            for (int side = 0; side < 2; side++) {
+                if (writeAll(commandFds[side], "d", 1)) {
+                    received[side] = receiveWorldState(resultFds[side], snapshots[side], shots[side]);
+                }
+            }
+
+            if (received[0] != nullptr && received[1] != nullptr) {
+                cout << "First difference after tick " << snapshots[0].tick << " (" << KERNEL_NAMES[levels[0]]
+                     << " vs " << KERNEL_NAMES[levels[1]] << "):\n";
+                if (states[0] != states[1]) {
+                    cout << "  game " << outcomes[states[0]] << " vs " << outcomes[states[1]] << "\n";
+                }
+                int differences = reportWorldDifferences(snapshots[0], received[0], shots[0],
+                                                         snapshots[1], received[1], shots[1]);
+                if (differences == 0) {
+                    cout << "  hashes differ in state the snapshot doesn't cover\n";
+                }
+            } else {
+                cerr << "A differential run stopped unexpectedly\n";
+            }
+            delete[] received[0];
+            delete[] received[1];
+            result = 1;
+            break;
+        }
+
+        if (states[0] != 0) {
+            cout << "No differences - " << outcomes[states[0]] << ", world hash " << hex << hashes[0] << dec
+                 << "\n";
+            break;
+        }
+    }
+
+    for (int side = 0; side < 2; side++) {
+        writeAll(commandFds[side], "q", 1);
+        close(commandFds[side]);
+        close(resultFds[side]);
+        waitpid(children[side], nullptr, 0);
+    }
+    return result;
+#endif
+}
+
+// ========================================
+// BOT PLAYERS
+// ========================================
+
+// Bots press the same keys a player would, one per tick, through applyInputKey().
+// They only read the world, so any policy works with every other option.
+
+const int BOT_POLICY_COUNT = 3;
+
+const BotPolicy BOT_POLICIES[BOT_POLICY_COUNT] = {
+    {"aggressive", decideAggressive},     // Runs at the nearest enemy and slashes it
+    {"kiting", decideKiting},             // Keeps its distance and shoots along the row
+    {"boss-dodging", decideBossDodging},  // Aggressive, but leaves the Boss blast area during the telegraph
+};
+
+const BotPolicy* findBotPolicy(const char* name) {
+    for (int b = 0; b < BOT_POLICY_COUNT; b++) {
+        if (strcmp(BOT_POLICIES[b].name, name) == 0) return &BOT_POLICIES[b];
+    }
+
+    cerr << "Unknown bot " << name << ", available:";
+    for (int b = 0; b < BOT_POLICY_COUNT; b++) {
+        cerr << " " << BOT_POLICIES[b].name;
+    }
+    cerr << "\n";
+    return nullptr;
+}
+
+// Nearest active enemy by Chebyshev distance, -1 if there is none
+int findNearestEnemy() {
+    int nearest = -1;
+    int nearestDistance = 0;
+
+    for (int i = 0; i < enemyCount; i++) {
+        if (!enemies[i].isActive) continue;
+
+        int dx = abs(enemies[i].x - player.x);
+        int dy = abs(enemies[i].y - player.y);
+        int distance = (dx > dy) ? dx : dy;
+        if (nearest < 0 || distance < nearestDistance) {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+// Direction key of a slash that would catch the enemy right now, 0 if none would
+char meleeKeyFor(const Enemy& enemy) {
+    const char directions[] = {'i', 'j', 'k', 'l'};
+    const EnemyTraits& traits = traitsOf(enemy.type);
+
+    for (int d = 0; d < 4; d++) {
+        int originX, originY, x0, y0, x1, y1;
+        getAttackOrigin(directions[d], player.x, player.y, originX, originY);
+        getSlashRect(directions[d], originX, originY, x0, y0, x1, y1);
+        if (rectsOverlap(enemy.x - traits.halfWidth, enemy.y - traits.halfHeight,
+                         enemy.x + traits.halfWidth, enemy.y + traits.halfHeight, x0, y0, x1, y1)) {
+            return directions[d];
+        }
+    }
+    return 0;
+}
+
+bool canAttackNow() {
+    return combatStyle == 2 || (attackCooldown == 0 && !currentAttack.isActive);
+}
+
+// Step toward a cell - jump (and double jump at the top of the arc) when it is above
+char approachKey(int targetX, int targetY) {
+    if (targetY < player.y - 1) {
+        if (player.isOnGround) return 'w';
+        if (player.canDoubleJump && player.velocityY >= 0) return 'w';
+    }
+    if (targetX < player.x) return 'a';
+    if (targetX > player.x) return 'd';
+    return 0;
+}
+
+// Step away from a column, past it when a wall is in the way
+char retreatKey(int fromX) {
+    int away = (fromX > player.x || (fromX == player.x && player.x > ARENA_WIDTH / 2)) ? -1 : 1;
+    int nextX = player.x + away;
+    if (nextX < 1 || nextX > ARENA_WIDTH - 2) {
+        return player.isOnGround ? 'w' : ((away < 0) ? 'd' : 'a');
+    }
+    return (away < 0) ? 'a' : 'd';
+}
+
+char decideAggressive() {
+    int nearest = findNearestEnemy();
+    if (nearest < 0) return 0;
+
+    const Enemy& enemy = enemies[nearest];
+    char melee = meleeKeyFor(enemy);
+    if (melee != 0) {
+        return canAttackNow() ? melee : retreatKey(enemy.x); // Out of contact until the cooldown is over
+    }
+
+    // Shoot when it is straight ahead on the player's row
+    int dx = enemy.x - player.x;
+    if (abs(enemy.y - player.y) <= traitsOf(enemy.type).halfHeight && dx * player.facing > 0 &&
+        playerShotCooldown == 0) {
+        return 'o';
+    }
+    return approachKey(enemy.x, enemy.y);
+}
+
+char decideKiting() {
+    int nearest = findNearestEnemy();
+    if (nearest < 0) return 0;
+
+    const Enemy& enemy = enemies[nearest];
+    int dx = enemy.x - player.x;
+    int distance = (abs(dx) > abs(enemy.y - player.y)) ? abs(dx) : abs(enemy.y - player.y);
+
+    char melee = meleeKeyFor(enemy);
+    if (melee != 0 && canAttackNow()) return melee; // Caught up with us
+
+    // In line and facing it - shoot before anything else
+    bool inLine = abs(enemy.y - player.y) <= traitsOf(enemy.type).halfHeight;
+    if (inLine && dx * player.facing > 0 && playerShotCooldown == 0) return 'o';
+
+    if (distance < BOT_KITE_DISTANCE) {
+        return retreatKey(enemy.x);
+    }
+
+    // Turning also steps toward it, so only turn with room to spare -
+    // otherwise the step lands back inside the back-off range
+    if (inLine) {
+        if (dx * player.facing < 0 && distance > BOT_KITE_DISTANCE) return (dx < 0) ? 'a' : 'd';
+        return 0;
+    }
+    return approachKey(enemy.x, enemy.y);
+}
+
+char decideBossDodging() {
+    int boss = -1;
+    for (int i = 0; i < enemyCount; i++) {
+        if (enemies[i].isActive && enemies[i].type == 'B') {
+            boss = i;
+            break;
+        }
+    }
+    if (boss < 0) return decideAggressive();
+
+    const Enemy& enemy = enemies[boss];
+    constexpr int halfWidth = traitsOf('B').halfWidth;
+    int dx = player.x - enemy.x;
+    bool inBlast = abs(dx) <= BOSS_AOE_RANGE && abs(player.y - enemy.y) <= BOSS_AOE_RANGE;
+    char towardBoss = (dx > 0) ? 'a' : 'd';
+
+    // Telegraph is up - get out of the 11x11 area and wait for the blast
+    if (enemy.attackState != 0) {
+        if (!inBlast) return 0;
+
+        int away = (dx >= 0) ? 1 : -1;
+        int room = (away > 0) ? ARENA_WIDTH - 2 - player.x : player.x - 1;
+        if (room > BOSS_AOE_RANGE - abs(dx)) {
+            return (away < 0) ? 'a' : 'd';
+        }
+
+        // Cornered against a wall - jump high and across the Boss to the open side
+        if (player.isOnGround) return 'w';
+        if (player.canDoubleJump && player.velocityY >= 0) return 'w';
+        return towardBoss;
+    }
+
+    char melee = meleeKeyFor(enemy);
+    if (melee != 0 && canAttackNow()) return melee;
+
+    // Walking at us - running away only keeps us in contact, so jump over it
+    bool approaching = enemy.velocityX * dx > 0;
+    if (approaching && abs(dx) <= halfWidth + 2) {
+        return player.isOnGround ? 'w' : towardBoss;
+    }
+
+    // Shoot when it is straight ahead on the player's row
+    if (abs(enemy.y - player.y) <= traitsOf('B').halfHeight && dx * player.facing < 0 &&
+        playerShotCooldown == 0) {
+        return 'o';
+    }
+    if (melee != 0) return 0; // Walking away from us - wait for the cooldown
+    return approachKey(enemy.x, enemy.y);
+}
+
+void printHeadlessReport(long long elapsedMicros) {
+    cout << "Headless run (" << ((activeBot != nullptr) ? activeBot->name : "no") << " bot, combat style "
+         << combatStyle << ")\n";
+    cout << "  ticks " << currentTick << " in " << elapsedMicros / 1000 << " ms";
+    if (elapsedMicros > 0) {
+        cout << " - " << (long long)currentTick * 1000000 / elapsedMicros << " ticks/s";
+    }
+    cout << "\n";
+    cout << "  wave " << ((currentWave > MAX_WAVES) ? MAX_WAVES : currentWave) << "/" << MAX_WAVES << ", "
+         << gameOutcome << " with " << player.hp << " HP\n";
+
+    char line[64];
+    snprintf(line, sizeof(line), "  world hash %016llx", runHash);
+    cout << line;
+    if (deterministicMode) {
+        cout << " (seed " << gameSeed << ")";
+    }
+    cout << "\n";
+}
+
+// ========================================
+// SCENARIOS
+// ========================================
+
+// Reads a scenario file: the wave, player and exact enemy population to start
+// from. Lines are directives, '#' starts a comment:
+//   scenario <version>
+//   seed <n>          (reseeds rand() - later directives and the game use it)
+//   wave <n>
+//   style <1|2>
+//   player <x> <y> <hp>
+//   enemy <type> <x> <y> <vx> <vy> <hp> <surface> <wrapStep> <attackState> <timer> <shotTimer>
+// The enemy fields are the ones addEnemy() sets. timer is the delay to the next
+// Flier descent or Boss state change, shotTimer the delay to the next Flier
+// shot; -1 uses the delay a fresh spawn gets.
+bool loadScenario(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        cerr << "Could not open " << path << "\n";
+        return false;
+    }
+
+    char line[SCENARIO_LINE_LENGTH];
+    char keyword[16];
+    int lineNumber = 0;
+    bool hasHeader = false;
+    const char* error = nullptr;
+
+    while (error == nullptr && fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+        if (sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#') continue;
+
+        if (!hasHeader) {
+            int version;
+            if (strcmp(keyword, "scenario") != 0 || sscanf(line, "%*s %d", &version) != 1) {
+                error = "missing 'scenario' header";
+            } else if (version != SCENARIO_VERSION) {
+                error = "unsupported scenario version";
+            }
+            hasHeader = true;
+        } else if (strcmp(keyword, "seed") == 0) {
+            unsigned int seed;
+            if (sscanf(line, "%*s %u", &seed) != 1) error = "bad seed";
+            else srand(seed);
+        } else if (strcmp(keyword, "wave") == 0) {
+            int wave;
+            if (sscanf(line, "%*s %d", &wave) != 1 || wave < 1 || wave > MAX_WAVES) error = "bad wave";
+            else currentWave = wave;
+        } else if (strcmp(keyword, "style") == 0) {
+            int style;
+            if (sscanf(line, "%*s %d", &style) != 1 || (style != 1 && style != 2)) error = "bad style";
+            else combatStyle = style;
+        } else if (strcmp(keyword, "player") == 0) {
+            int x, y, hp;
+            if (sscanf(line, "%*s %d %d %d", &x, &y, &hp) != 3 || x < 1 || x >= ARENA_WIDTH - 1 ||
+                y < 1 || y >= ARENA_HEIGHT - 1 || hp < 1) {
+                error = "bad player";
+            } else {
+                player.x = x;
+                player.y = y;
+                player.hp = hp;
+            }
+        } else if (strcmp(keyword, "enemy") == 0) {
+            char type, surface;
+            int x, y, velocityX, velocityY, hp, wrapStep, attackState, timer, shotTimer;
+            int fields = sscanf(line, "%*s %c %d %d %d %d %d %c %d %d %d %d", &type, &x, &y,
+                                &velocityX, &velocityY, &hp, &surface, &wrapStep, &attackState,
+                                &timer, &shotTimer);
+            if (fields != 11 || traitsOf(type).type != type || type == ' ') {
+                error = "bad enemy";
+            } else if (x < 1 || x >= ARENA_WIDTH - 1 || y < 1 || y >= ARENA_HEIGHT - 1) {
+                error = "enemy outside the arena";
+            } else if (hp < 1 || strchr("frlc", surface) == nullptr || wrapStep < 0 || wrapStep > 8 ||
+                       attackState < 0 || attackState > 2) {
+                error = "bad enemy state";
+            } else {
+                int index = placeEnemy(type, x, y);
+                Enemy& enemy = enemies[index];
+                enemy.velocityX = velocityX;
+                enemy.velocityY = velocityY;
+                enemy.hp = hp;
+                enemy.surface = surface;
+                enemy.edgeWrapStep = wrapStep;
+                enemy.attackState = attackState;
+                scheduleEnemyTimers(enemy, timer, shotTimer);
+            }
+        } else {
+            error = "unknown directive";
+        }
+    }
+    fclose(file);
+
+    if (error == nullptr && !hasHeader) {
+        error = "empty scenario";
+    }
+    if (error != nullptr) {
+        cerr << path << ":" << lineNumber << ": " << error << "\n";
+        return false;
+    }
+
+    // The wave starts with its whole population in place
+    activeSpawnCurve = WAVE_SPAWN_CURVES[currentWave];
+    spawnQueueHead = 0;
+    enemyCountToSpawn = 0;
+    scenarioLoaded = true;
+    return true;
+}
+
+void writeScenarioHeader(FILE* file, int seed, int wave) {
+    fprintf(file, "scenario %d\n", SCENARIO_VERSION);
+    fprintf(file, "seed %d\n", seed);
+    fprintf(file, "wave %d\n", wave);
+    fprintf(file, "style 1\n");
+    fprintf(file, "player %d %d %d\n", ARENA_WIDTH / 2, ARENA_HEIGHT - 2, PLAYER_MAX_HP);
+}
+
+// 10k crawlers on the tops and undersides of the platforms, each heading for
+// the nearer edge so the whole swarm keeps wrapping around them
+void generateCrawlerSwarm(FILE* file) {
+    const int crawlers = 10000;
+    const int platformYs[] = {ARENA_HEIGHT - 6, ARENA_HEIGHT - 12, ARENA_HEIGHT - 18};
+
+    writeScenarioHeader(file, 1, 2);
+    fprintf(file, "# enemy type x y vx vy hp surface wrapStep attackState timer shotTimer\n");
+    for (int i = 0; i < crawlers; i++) {
+        int row = platformYs[i % 3];
+        int count = spawnSurfaceCount[row];
+        if (count == 0) continue;
+
+        int n = i / 3;
+        int x = spawnSurfaceX[row][n % count];
+        int middle = (spawnSurfaceX[row][0] + spawnSurfaceX[row][count - 1]) / 2;
+        int direction = (x < middle) ? -1 : 1;
+
+        // Alternate whole passes between the top and the underside
+        if ((n / count) % 2 == 0) {
+            fprintf(file, "enemy C %d %d %d 0 1 f 0 0 -1 -1\n", x, row - 1, direction);
+        } else {
+            fprintf(file, "enemy C %d %d %d 0 1 c 0 0 -1 -1\n", x, row + 1, direction);
+        }
+    }
+}
+
+// 2k fliers packed into the row under the ceiling, all due to descend on the
+// first tick and with their shots spread over one shot interval
+void generateFlierRow(FILE* file) {
+    const int fliers = 2000;
+
+    writeScenarioHeader(file, 1, 3);
+    fprintf(file, "# enemy type x y vx vy hp surface wrapStep attackState timer shotTimer\n");
+    for (int i = 0; i < fliers; i++) {
+        int x = 1 + i % (ARENA_WIDTH - 2);
+        int direction = (i % 2 == 0) ? 1 : -1;
+        fprintf(file, "enemy F %d 2 %d 0 1 f 0 0 0 %d\n", x, direction, 1 + i % FLIER_SHOT_INTERVAL);
+    }
+}
+
+const int SCENARIO_GENERATOR_COUNT = 2;
+
+const ScenarioGenerator SCENARIO_GENERATORS[SCENARIO_GENERATOR_COUNT] = {
+    {"crawlers-10k", generateCrawlerSwarm},
+    {"fliers-2k-row", generateFlierRow},
+};
+
+// Write a named scenario - generators only read the default arena
+int generateScenario(const char* name, const char* path) {
+    const ScenarioGenerator* generator = nullptr;
+    for (int g = 0; g < SCENARIO_GENERATOR_COUNT; g++) {
+        if (strcmp(SCENARIO_GENERATORS[g].name, name) == 0) generator = &SCENARIO_GENERATORS[g];
+    }
+    if (generator == nullptr) {
+        cerr << "Unknown scenario " << name << ", available:";
+        for (int g = 0; g < SCENARIO_GENERATOR_COUNT; g++) {
+            cerr << " " << SCENARIO_GENERATORS[g].name;
+        }
+        cerr << "\n";
+        return 1;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        cerr << "Could not create " << path << "\n";
+        return 1;
+    }
+
+    initializeArena();
+    generator->write(file);
+    fclose(file);
+    return 0;
+}
+
+// ========================================
+// EVENT JOURNAL
+// ========================================
+
+// Map the journal ring file - events are plain stores into shared memory,
+// so writing never blocks the tick (the kernel flushes pages in the background)
+bool openJournal(const char* path) {
+#ifdef _WIN32
+    (void)path;
+    cerr << "Event journal is not supported on this platform\n";
+    return true;
+#else
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    size_t size = sizeof(JournalHeader) + (size_t)JOURNAL_CAPACITY * sizeof(JournalRecord);
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    journal = (JournalHeader*)mapped;
+    journal->magic = JOURNAL_MAGIC;
+    journal->version = JOURNAL_VERSION;
+    journal->capacity = JOURNAL_CAPACITY;
+    journal->recordSize = sizeof(JournalRecord);
+    journal->writeCount = 0;
+    journalRecords = (JournalRecord*)(journal + 1);
+    journalMappedSize = size;
+    return true;
+#endif
+}
+
+void closeJournal() {
+#ifndef _WIN32
+    if (journal != nullptr) {
+        munmap(journal, journalMappedSize);
+    }
+#endif
+    journal = nullptr;
+    journalRecords = nullptr;
+}
+
+// Append one record to the ring (no-op when the journal is off)
+void logEvent(unsigned char type, char enemyType, int x, int y, int value) {
+    if (journal == nullptr) return;
+
+    JournalRecord& record = journalRecords[journal->writeCount % JOURNAL_CAPACITY];
+    record.tick = currentTick;
+    record.type = type;
+    record.enemyType = enemyType;
+    record.x = (short)x;
+    record.y = (short)y;
+    record.value = (short)value;
+    record.wave = (unsigned short)currentWave;
+    record.reserved = 0;
+    journal->writeCount++;
+}
+
+// Reader - per-wave totals from a journal file
+int summarizeJournal(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    JournalHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != JOURNAL_MAGIC ||
+        header.version != JOURNAL_VERSION || header.recordSize != sizeof(JournalRecord)) {
+        cerr << path << " is not an event journal\n";
+        fclose(file);
+        return 1;
+    }
+
+    // The ring must be non-empty and actually stored in the file
+    long fileSize = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        fileSize = ftell(file);
+    }
+    if (header.capacity == 0 ||
+        (unsigned long long)fileSize < sizeof(JournalHeader) + (unsigned long long)header.capacity * sizeof(JournalRecord)) {
+        cerr << path << " is truncated or has a damaged header\n";
+        fclose(file);
+        return 1;
+    }
+
+    // Per-wave counters (index 0 unused), per enemy kind in ENEMY_TRAITS order
+    unsigned int startTick[MAX_WAVES + 1] = {0}, endTick[MAX_WAVES + 1] = {0};
+    int spawns[MAX_WAVES + 1][ENEMY_KIND_COUNT] = {{0}}, kills[MAX_WAVES + 1][ENEMY_KIND_COUNT] = {{0}};
+    int hits[MAX_WAVES + 1] = {0}, damageTaken[MAX_WAVES + 1] = {0};
+    bool seen[MAX_WAVES + 1] = {false}, ended[MAX_WAVES + 1] = {false};
+
+    // Oldest surviving record when the ring has wrapped
+    unsigned long long first = (header.writeCount > header.capacity) ? header.writeCount - header.capacity : 0;
+
+    for (unsigned long long n = first; n < header.writeCount; n++) {
+        JournalRecord record;
+        long offset = (long)(sizeof(JournalHeader) + (n % header.capacity) * sizeof(JournalRecord));
+        if (fseek(file, offset, SEEK_SET) != 0 || fread(&record, sizeof(record), 1, file) != 1) break;
+
+        int wave = record.wave;
+        if (wave < 1 || wave > MAX_WAVES) continue;
+
+        int kind = 0;
+        while (kind < ENEMY_KIND_COUNT && ENEMY_TRAITS[kind].type != record.enemyType) kind++;
+
+        if (!seen[wave]) {
+            seen[wave] = true;
+            startTick[wave] = record.tick;
+        }
+
+        switch (record.type) {
+            case EVENT_WAVE_START: startTick[wave] = record.tick; break;
+            case EVENT_WAVE_END:   endTick[wave] = record.tick; ended[wave] = true; break;
+            case EVENT_SPAWN:      if (kind < ENEMY_KIND_COUNT) spawns[wave][kind]++; break;
+            case EVENT_KILL:       if (kind < ENEMY_KIND_COUNT) kills[wave][kind]++; break;
+            case EVENT_HIT:        hits[wave]++; break;
+            case EVENT_PLAYER_DAMAGE: damageTaken[wave] += record.value; break;
+        }
+    }
+    fclose(file);
+
+    cout << "Journal " << path << ": " << header.writeCount << " events";
+    if (first > 0) cout << " (oldest " << first << " overwritten)";
+    cout << "\n\n";
+    // Column labels follow the kinds, e.g. "Spawned (E/J/F/C/B)"
+    string kindList;
+    for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+        if (k > 0) kindList += '/';
+        kindList += ENEMY_TRAITS[k].type;
+    }
+    size_t columnWidth = ENEMY_KIND_COUNT * 4 + 3; // "%3d" per kind, '/' between, 4-space gap
+    string spawnedLabel = "Spawned (" + kindList + ")";
+    string killedLabel = "Killed (" + kindList + ")";
+    if (spawnedLabel.size() < columnWidth) spawnedLabel.resize(columnWidth, ' ');
+    if (killedLabel.size() < columnWidth) killedLabel.resize(columnWidth, ' ');
+    cout << "Wave  Ticks   " << spawnedLabel << killedLabel << "Hits  Damage taken\n";
+
+    for (int wave = 1; wave <= MAX_WAVES; wave++) {
+        if (!seen[wave]) continue;
+
+        // Duration, or '-' if the wave never ended
+        char ticks[16] = "-";
+        if (ended[wave]) snprintf(ticks, sizeof(ticks), "%u", endTick[wave] - startTick[wave]);
+
+        char line[64];
+        snprintf(line, sizeof(line), "%4d  %5s  ", wave, ticks);
+        cout << line;
+
+        for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+            snprintf(line, sizeof(line), (k > 0) ? "/%3d" : "%3d", spawns[wave][k]);
+            cout << line;
+        }
+        cout << "    ";
+        for (int k = 0; k < ENEMY_KIND_COUNT; k++) {
+            snprintf(line, sizeof(line), (k > 0) ? "/%3d" : "%3d", kills[wave][k]);
+            cout << line;
+        }
+
+        snprintf(line, sizeof(line), "  %5d  %5d\n", hits[wave], damageTaken[wave]);
+        cout << line;
+    }
+    return 0;
+}
+
+// ========================================
+// INPUT LATENCY
+// ========================================
+
+long long nowMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Called once the frame is flushed - closes the oldest unanswered key press
+void recordInputLatency() {
+    if (pendingInputTime < 0 || !lastFrameComplete) return;
+
+    long long latency = nowMicroseconds() - pendingInputTime;
+    pendingInputTime = -1;
+
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && latency >= (64LL << bucket)) {
+        bucket++;
+    }
+
+    latencyHistogram[bucket]++;
+    latencySamples++;
+    latencyTotal += latency;
+}
+
+void printLatencyReport() {
+    cout << "\nInput-to-display latency (" << (lowLatencyMode ? "low-latency" : "default") << " mode)\n";
+    if (latencySamples == 0) {
+        cout << "  no key presses recorded\n";
+        return;
+    }
+
+    long long largest = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (latencyHistogram[b] > largest) largest = latencyHistogram[b];
+    }
+
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (latencyHistogram[b] == 0) continue;
+
+        char line[64];
+        if (b == LATENCY_BUCKETS - 1) {
+            snprintf(line, sizeof(line), "  >= %7lld us  %6lld  ", 32LL << b, latencyHistogram[b]);
+        } else {
+            snprintf(line, sizeof(line), "  <  %7lld us  %6lld  ", 64LL << b, latencyHistogram[b]);
+        }
+        cout << line << string((size_t)(latencyHistogram[b] * 40 / largest), '#') << "\n";
+    }
+
+    cout << "  samples " << latencySamples << ", mean " << latencyTotal / latencySamples << " us\n";
+}
+
+// ========================================
+// OUTPUT METRICS
+// ========================================
+
+// Roll the per-second output rates shown in the HUD
+void updateOutputStats() {
+    long long now = nowMicroseconds();
+    if (outputWindowStart < 0) {
+        outputWindowStart = now;
+        return;
+    }
+
+    long long elapsed = now - outputWindowStart;
+    if (elapsed < 1000000) return;
+
+    outputBytesPerSecond = (int)(outputWindowBytes * 1000000 / elapsed);
+    outputFramesPerSecond = (int)(outputWindowFrames * 1000000 / elapsed);
+    outputSkippedPerSecond = (int)(outputWindowSkipped * 1000000 / elapsed);
+    outputWritesPerFrame = (outputWindowFrames > 0) ? (double)outputWindowWrites / outputWindowFrames : 0;
+
+    outputWindowStart = now;
+    outputWindowBytes = 0;
+    outputWindowFrames = 0;
+    outputWindowSkipped = 0;
+    outputWindowWrites = 0;
+}
+
+void printOutputReport() {
+    long long rendered = outputFramesSent + outputFramesSkipped;
+    cout << "\nTerminal output\n";
+    cout << "  frames sent " << outputFramesSent << ", skipped " << outputFramesSkipped;
+    if (rendered > 0) {
+        cout << " (" << outputFramesSkipped * 100 / rendered << "%)";
+    }
+    cout << "\n";
+    cout << "  bytes " << outputBytes;
+    if (outputFramesSent > 0) {
+        cout << " (" << outputBytes / outputFramesSent << " per frame)";
+    }
+    cout << "\n";
+    cout << "  write calls " << outputWrites << ", refused by the terminal " << outputStalls << "\n";
+}
+
+// ========================================
+// SPECTATOR FEED
+// ========================================
+
+// Create the shared memory ring that spectators attach to
+bool openSpectatorFeed(const char* name) {
+#ifdef _WIN32
+    (void)name;
+    cerr << "Spectator feed is not supported on this platform\n";
+    return true;
+#else
+    // POSIX shared memory names start with a single '/'
+    snprintf(spectatorShmName, sizeof(spectatorShmName), "%s%s", (name[0] == '/') ? "" : "/", name);
+
+    int fd = shm_open(spectatorShmName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    if (ftruncate(fd, sizeof(SpectatorFeed)) != 0) {
+        close(fd);
+        shm_unlink(spectatorShmName);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, sizeof(SpectatorFeed), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(spectatorShmName);
+        return false;
+    }
+
+    spectatorFeed = new (mapped) SpectatorFeed;
+    spectatorFeed->width = ARENA_WIDTH;
+    spectatorFeed->height = ARENA_HEIGHT;
+    spectatorFeed->ringFrames = SPECTATOR_RING_FRAMES;
+    spectatorFeed->framesPublished.store(0);
+    for (int f = 0; f < SPECTATOR_RING_FRAMES; f++) {
+        spectatorFeed->frames[f].sequence.store(0);
+    }
+    spectatorFeed->isLive.store(1);
+    spectatorFeed->magic = SPECTATOR_MAGIC; // Last, so readers never see a half-built feed
+    return true;
+#endif
+}
+
+void closeSpectatorFeed() {
+#ifndef _WIN32
+    if (spectatorFeed != nullptr) {
+        spectatorFeed->isLive.store(0, std::memory_order_release);
+        munmap(spectatorFeed, sizeof(SpectatorFeed));
+        shm_unlink(spectatorShmName);
+    }
+#endif
+    spectatorFeed = nullptr;
+}
+
+// Copy the composed frame into the next ring slot under its seqlock.
+// The game never waits for readers - a reader that loses a race retries.
+void publishSpectatorFrame() {
+    if (spectatorFeed == nullptr) return;
+
+    unsigned long long frameNumber = spectatorFeed->framesPublished.load(std::memory_order_relaxed);
+    SpectatorFrame& slot = spectatorFeed->frames[frameNumber % SPECTATOR_RING_FRAMES];
+
+    unsigned int sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frameNumber = (unsigned int)frameNumber;
+    slot.hp = player.hp;
+    slot.wave = currentWave;
+    slot.maxWaves = MAX_WAVES;
+    memcpy(slot.glyph, composedGlyph, sizeof(slot.glyph));
+    memcpy(slot.color, composedColor, sizeof(slot.color));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    spectatorFeed->framesPublished.store(frameNumber + 1, std::memory_order_release);
+}
+
+// Spectator - render the newest frame straight out of shared memory
+int watchSpectatorFeed(const char* name) {
+#ifdef _WIN32
+    (void)name;
+    cerr << "Spectator feed is not supported on this platform\n";
+    return 1;
+#else
+    char shmName[64];
+    snprintf(shmName, sizeof(shmName), "%s%s", (name[0] == '/') ? "" : "/", name);
+
+    int fd = shm_open(shmName, O_RDONLY, 0);
+    if (fd < 0) {
+        cerr << "No spectator feed named " << name << "\n";
+        return 1;
+    }
+
+    void* mapped = mmap(nullptr, sizeof(SpectatorFeed), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return 1;
+
+    const SpectatorFeed* feed = (const SpectatorFeed*)mapped;
+    if (feed->magic != SPECTATOR_MAGIC || feed->width != ARENA_WIDTH || feed->height != ARENA_HEIGHT) {
+        cerr << name << " is not a compatible spectator feed\n";
+        munmap(mapped, sizeof(SpectatorFeed));
+        return 1;
+    }
+
+    initializeConsole();
+    hideCursor();
+    clearScreen();
+
+    unsigned long long lastShown = 0;
+    while (!quitRequested) {
+        if (keyPressed()) {
+            char ch = readKey();
+            if (ch == 'q' || ch == 'Q' || ch == 27) break;
+        }
+
+        unsigned long long published = feed->framesPublished.load(std::memory_order_acquire);
+        if (published == lastShown) {
+            if (!feed->isLive.load(std::memory_order_acquire)) break;
+            sleepMs(FRAME_DELAY_MS / 4);
+            continue;
+        }
+
+        const SpectatorFrame& slot = feed->frames[(published - 1) % SPECTATOR_RING_FRAMES];
+        unsigned int before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            // Game is writing this slot - give it a moment
+            if (!feed->isLive.load(std::memory_order_acquire)) break;
+            sleepMs(1);
+            continue;
+        }
+
+        // Terminal still busy with the last frame - show the newest one once it's done
+        if (!pumpOutput()) {
+            sleepMs(FRAME_DELAY_MS / 4);
+            continue;
+        }
+
+        frameLength = 0;
+        char line[96];
+        int length = snprintf(line, sizeof(line), "\x1b[HHP: %d | Wave: %d/%d | spectating frame %u\x1b[K\n",
+                              slot.hp, slot.wave, slot.maxWaves, slot.frameNumber);
+        appendFrame(line, length);
+        appendArenaCells(slot.glyph, slot.color);
+
+        // Only show the frame if the slot was not rewritten while we read it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+
+        flushFrame();
+        lastShown = published;
+    }
+
+    munmap(mapped, sizeof(SpectatorFeed));
+    restoreConsole();
+    cout << "\n";
+    return 0;
+#endif
+}
+
+// ========================================
+// SESSION RECORDING
+// ========================================
+
+// Run-length encode as (count, value) byte pairs - returns the encoded size
+int encodeRle(const unsigned char* source, int length, unsigned char* output) {
+    int written = 0;
+    int i = 0;
+
+    while (i < length) {
+        unsigned char value = source[i];
+        int run = 1;
+        while (i + run < length && run < 255 && source[i + run] == value) {
+            run++;
+        }
+
+        output[written++] = (unsigned char)run;
+        output[written++] = value;
+        i += run;
+    }
+    return written;
+}
+
+// Inverse of encodeRle - false if the data does not fill exactly outputLength bytes
+bool decodeRle(const unsigned char* source, int length, unsigned char* output, int outputLength) {
+    int filled = 0;
+
+    for (int i = 0; i + 1 < length; i += 2) {
+        int run = source[i];
+        if (filled + run > outputLength) return false;
+
+        memset(output + filled, source[i + 1], run);
+        filled += run;
+    }
+    return filled == outputLength;
+}
+
+bool openRecording(const char* path) {
+    recordingFile = fopen(path, "wb");
+    if (recordingFile == nullptr) return false;
+
+    RecordingHeader header = {RECORDING_MAGIC, RECORDING_VERSION, ARENA_WIDTH, ARENA_HEIGHT,
+                              RECORDING_KEYFRAME_INTERVAL};
+    if (fwrite(&header, sizeof(header), 1, recordingFile) != 1) {
+        fclose(recordingFile);
+        recordingFile = nullptr;
+        return false;
+    }
+    recordedFrames = 0;
+    return true;
+}
+
+void closeRecording() {
+    if (recordingFile != nullptr) {
+        fclose(recordingFile);
+        recordingFile = nullptr;
+    }
+}
+
+// Append the composed frame - a full keyframe every RECORDING_KEYFRAME_INTERVAL
+// frames, otherwise the XOR with the previous frame (mostly zeros, so RLE shrinks it)
+void recordFrame() {
+    if (recordingFile == nullptr) return;
+
+    const int cells = ARENA_HEIGHT * ARENA_WIDTH;
+    memcpy(recordPlanes, composedGlyph, cells);
+    memcpy(recordPlanes + cells, composedColor, cells);
+
+    RecordedFrameHeader header;
+    header.frameNumber = recordedFrames;
+    header.hp = player.hp;
+    header.wave = (short)currentWave;
+    header.isKeyframe = (recordedFrames % RECORDING_KEYFRAME_INTERVAL == 0) ? 1 : 0;
+    header.reserved = 0;
+
+    if (header.isKeyframe) {
+        header.payloadSize = encodeRle(recordPlanes, RECORDING_PLANE_SIZE, recordPayload);
+    } else {
+        for (int i = 0; i < RECORDING_PLANE_SIZE; i++) {
+            recordPrevious[i] ^= recordPlanes[i];
+        }
+        header.payloadSize = encodeRle(recordPrevious, RECORDING_PLANE_SIZE, recordPayload);
+    }
+
+    // Flushed per frame so every finished frame survives a hard exit. A failed
+    // write (disk full) ends the recording - what is on disk stays playable.
+    if (fwrite(&header, sizeof(header), 1, recordingFile) != 1 ||
+        fwrite(recordPayload, 1, header.payloadSize, recordingFile) != header.payloadSize ||
+        fflush(recordingFile) != 0) {
+        fclose(recordingFile);
+        recordingFile = nullptr;
+        recordingFailed = true;
+        return;
+    }
+
+    memcpy(recordPrevious, recordPlanes, RECORDING_PLANE_SIZE);
+    recordedFrames++;
+}
+
+// Decode frames so that planes hold frame target - starts from the nearest
+// keyframe unless the current frame can simply be stepped forward
+bool seekReplay(FILE* file, const ReplayIndexEntry* index, int target, int& current, unsigned char* planes) {
+    static unsigned char delta[RECORDING_PLANE_SIZE];
+    int from;
+    if (target > current && current >= 0 && target - current <= RECORDING_KEYFRAME_INTERVAL) {
+        from = current + 1;
+    } else {
+        from = target;
+        while (from > 0 && !index[from].header.isKeyframe) from--;
+    }
+
+    for (int f = from; f <= target; f++) {
+        const RecordedFrameHeader& header = index[f].header;
+        if (header.payloadSize > sizeof(recordPayload)) return false;
+
+        fseek(file, index[f].offset + (long)sizeof(RecordedFrameHeader), SEEK_SET);
+        if (fread(recordPayload, 1, header.payloadSize, file) != header.payloadSize) return false;
+
+        if (header.isKeyframe) {
+            if (!decodeRle(recordPayload, header.payloadSize, planes, RECORDING_PLANE_SIZE)) return false;
+        } else {
+            if (!decodeRle(recordPayload, header.payloadSize, delta, RECORDING_PLANE_SIZE)) return false;
+            for (int i = 0; i < RECORDING_PLANE_SIZE; i++) {
+                planes[i] ^= delta[i];
+            }
+        }
+    }
+
+    current = target;
+    return true;
+}
+
+// Replay a recording at any speed with seeking
+int playRecording(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        cerr << "Could not open " << path << "\n";
+        return 1;
+    }
+
+    RecordingHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != RECORDING_MAGIC ||
+        header.version != RECORDING_VERSION || header.width != ARENA_WIDTH || header.height != ARENA_HEIGHT) {
+        cerr << path << " is not a compatible recording\n";
+        fclose(file);
+        return 1;
+    }
+
+    // Index every frame by walking the headers. A recording cut off mid-write
+    // ends at the last frame whose payload is all there.
+    long fileSize = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        fileSize = ftell(file);
+    }
+    fseek(file, (long)sizeof(header), SEEK_SET);
+
+    int frameCount = 0;
+    int indexCapacity = 1024;
+    ReplayIndexEntry* index = new ReplayIndexEntry[indexCapacity];
+
+    while (true) {
+        long offset = ftell(file);
+        RecordedFrameHeader frameHeader;
+        if (fread(&frameHeader, sizeof(frameHeader), 1, file) != 1) break;
+
+        long payloadEnd = offset + (long)sizeof(frameHeader) + (long)frameHeader.payloadSize;
+        if (frameHeader.payloadSize > sizeof(recordPayload) || payloadEnd > fileSize) break;
+        if (fseek(file, frameHeader.payloadSize, SEEK_CUR) != 0) break;
+
+        if (frameCount >= indexCapacity) {
+            ReplayIndexEntry* bigger = new ReplayIndexEntry[indexCapacity * 2];
+            for (int f = 0; f < frameCount; f++) bigger[f] = index[f];
+            delete[] index;
+            index = bigger;
+            indexCapacity *= 2;
+        }
+        index[frameCount].offset = offset;
+        index[frameCount].header = frameHeader;
+        frameCount++;
+    }
+
+    if (frameCount == 0 || !index[0].header.isKeyframe) {
+        cerr << path << " contains no frames\n";
+        delete[] index;
+        fclose(file);
+        return 1;
+    }
+
+    initializeConsole();
+    hideCursor();
+    clearScreen();
+
+    unsigned char planes[RECORDING_PLANE_SIZE];
+    int current = -1;
+    double position = (playStartFrame < frameCount) ? playStartFrame : frameCount - 1;
+    double speed = playSpeed;
+    bool paused = false;
+    bool ok = true;
+
+    while (ok && !quitRequested) {
+        if (keyPressed()) {
+            char ch = readKey();
+            if (ch == 'q' || ch == 'Q' || ch == 27) break;
+            if (ch == ' ') paused = !paused;
+            if (ch == '+' || ch == '=') speed *= 2;
+            if (ch == '-' || ch == '_') speed /= 2;
+            if (ch == 'l' || ch == 'L') position += REPLAY_SEEK_STEP;
+            if (ch == 'j' || ch == 'J') position -= REPLAY_SEEK_STEP;
+        }
+
+        if (position < 0) position = 0;
+        if (position > frameCount - 1) position = frameCount - 1;
+
+        int target = (int)position;
+        if (target != current) {
+            ok = seekReplay(file, index, target, current, planes);
+            if (!ok) break; // planes may be half-decoded, current may still be -1
+        }
+
+        // Frames the terminal can't keep up with are skipped, not queued
+        if (pumpOutput()) {
+            const RecordedFrameHeader& frame = index[current].header;
+            frameLength = 0;
+            char line[128];
+            int length = snprintf(line, sizeof(line), "\x1b[HHP: %d | Wave: %d/%d | replay %d/%d x%.2f%s\x1b[K\n",
+                                  frame.hp, frame.wave, MAX_WAVES, current + 1, frameCount, speed,
+                                  paused ? " (paused)" : "");
+            appendFrame(line, length);
+            appendArenaCells(planes, planes + ARENA_HEIGHT * ARENA_WIDTH);
+            flushFrame();
+        }
+
+        if (!paused) {
+            if (current == frameCount - 1) break;
+            position += speed;
+        }
+        sleepMs(FRAME_DELAY_MS);
+    }
+
+    delete[] index;
+    fclose(file);
+    restoreConsole();
+    cout << "\n";
+
+    if (!ok) {
+        cerr << path << " is damaged\n";
+        return 1;
+    }
+    return 0;
 }